@@ -5,6 +5,8 @@
  *
  * The asubExec module is written to be used in conjunction with the aSub record.
  * It uses the fork() and execvp() paradigm to launch a child process.
+ * The execution engine itself is in asubExecCore.c, this is the record glue,
+ * used by both the aSub functions below and the asubExec record.
  *
  * Copyright (c) 2018-2022  Australian Synchrotron
  *
@@ -48,6 +50,74 @@
  * info fields. Note the first process argument is automatically set to the record
  * name if not otherwise specified.
  *
+ * The type in which an input is sent may be specified using INTYPE_A ... INTYPE_U
+ * info fields, e.g. info (INTYPE_A, "DOUBLE"). Numeric inputs are converted
+ * (vectorised) by the IOC before being sent, so the child receives ready to use
+ * homogeneous arrays.
+ *
+ * If the PERF info field is "true", cycles, instructions, task clock, page faults
+ * and context switches are counted per execution (see asubExecPerf.h).
+ *
+ * Inputs may be sliced, and optionally reduced (block mean or maximum), before
+ * being sent using the ROI_A ... ROI_U info fields, e.g. info (ROI_A, "0:1000:4").
+ *
+ * FLOAT/DOUBLE outputs may be scaled, clamped and have NaNs replaced as they are
+ * decoded using the POST_VALA ... POST_VALU info fields, e.g.
+ * info (POST_VALA, "scale:2,0;clamp:0,10;nan:0").
+ *
+ * By default child processes are created using fork() and execvp(). The BACKEND
+ * info field may be set to "posix_spawn" to use posix_spawnp() instead, which
+ * is considerably cheaper for an IOC with a large memory footprint.
+ *
+ * Optional latency alarm thresholds (seconds) may be specified using the
+ * LATENCY_MINOR and LATENCY_MAJOR info fields, compared against either the last
+ * execution's latency or, if LATENCY_BASIS is "p95", a rolling 95th percentile.
+ * A breach raises a TIMEOUT alarm, MINOR or MAJOR severity respectively, so it
+ * is neither mistaken for a value limit nor for a failure (SOFT, INVALID).
+ *
+ * The execution rate may be limited using the MAXRATE info field (Hz), with an
+ * optional MAXBURST (default 1). Requests beyond the rate are deferred, not
+ * dropped: the record is re-processed when the next token is due, so the
+ * execution uses the latest inputs, and requests made in the meantime are
+ * coalesced into that one execution. Monitors and the forward link are only
+ * processed when the execution completes.
+ *
+ * Periodically scanned records may be spread across the scan period, rather than
+ * all executing on the same tick, using the STAGGER info field: "hash" for a
+ * deterministic phase from the record name, or "balanced" for the least used of
+ * STAGGER_SLOTS phases; spread over STAGGER_SPAN (default 0.5) of the period.
+ *
+ * If the MODE info field is "persistent", the child process is started once and
+ * kept running as a worker (e.g. using asubExecServer in asubExec.py), being sent
+ * a tagged request frame per execution.
+ *
+ * Persistent workers may be recycled, i.e. replaced, after RECYCLE_REQUESTS
+ * requests, when their RSS exceeds RECYCLE_RSS (MB), or when their recent mean
+ * latency exceeds RECYCLE_DRIFT times their initial (baseline) mean latency.
+ * The old worker serves requests until its replacement has answered a ready
+ * probe, and is then asked to exit.
+ *
+ * If the MODE info field is "detached", for records that only push data out,
+ * the record completes as soon as the input frame has been written to the child
+ * process; outputs are not written. The child's exit is accounted once it has
+ * exited, and at most DETACHED_MAX (default 8) children may be outstanding.
+ *
+ * The WARMUP info field may be "worker" (persistent mode only) to start the worker,
+ * or "dry" to run a dry execution with the current inputs, discarding the outputs,
+ * once the IOC is running. Warm ups are spaced asubExecWarmupSpacing seconds apart
+ * to avoid a fork storm at IOC start.
+ *
+ * The EXECLINK info field may name a STRING input, e.g. info (EXECLINK, "INPU"),
+ * the value of which selects the program to run, an empty value selecting EXEC.
+ * Only the programs listed in the EXECALLOW info field, e.g.
+ * info (EXECALLOW, "progA progB /opt/bin/progC"), may be selected; names are
+ * matched exactly, so a path name is only allowed if listed as such. Without
+ * EXECALLOW only the EXEC program may be selected. The EXEC_CACHE_SIZE most
+ * recently used programs (resolved path and persistent worker) are retained.
+ *
+ * Records with info (SINGLEFLIGHT, "true") that would execute the same argv with
+ * an identical input frame concurrently share a single execution.
+ *
  * Example:
  *
  * record (aSub, "RECORD_NAME") {
@@ -97,12 +167,16 @@
  * The *x fields are a direct binary copy of the input.
  *
  * The asubExec module verifies that the output received from the child process
- * is as expected. Currently type mis matches (FTVx) are not handled and are
- * essentially ignored - later releases of this module may include type casting.
+ * is as expected. Numeric type mis matches (FTVx) are converted, string/numeric
+ * type mis matches are discarded.
  *
  * Number of elements mis-matches (NOVx), are handled by discarding additonal
  * elements or leaving elements undefined if not enough were provided.
  *
+ * The asubExec record (see asubExecRecord.c) uses the same info fields, but
+ * has a configurable number of inputs and outputs (INTYPE_00 ... INTYPE_63)
+ * and sends version 1.3 counted frames.
+ *
  * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
  *
  * Note:
@@ -110,36 +184,42 @@
  */
 
 #include "asubExec.h"
+#include "asubExecCapture.h"
+#include "asubExecCore.h"
+#include "asubExecFlight.h"
+#include "asubExecGlue.h"
+#include "asubExecProbes.h"
+#include "asubExecShared.h"
+#include "asubExecStats.h"
+#include "asubExecTrace.h"
 
 #include <stdio.h>
 #include <stdbool.h>
+#include <stdlib.h>
 #include <string.h>
-#include <errno.h>
-#include <fcntl.h>
-#include <signal.h>
-#include <sys/time.h>
-#include <sys/types.h>
-#include <sys/wait.h>
-#include <time.h>
-#include <unistd.h>
 
 #include <aSubRecord.h>
 #include <alarm.h>
+#include <callback.h>
 #include <cantProceed.h>
 #include <dbAccess.h>
 #include <dbBase.h>
 #include <dbDefs.h>
+#include <dbScan.h>
 #include <dbStaticLib.h>
+#include <ellLib.h>
 #include <epicsEvent.h>
 #include <epicsThread.h>
 #include <epicsTime.h>
 #include <epicsExit.h>
 #include <epicsExport.h>
+#include <epicsMutex.h>
 #include <epicsString.h>
 #include <epicsStdlib.h>
 #include <epicsTypes.h>
 #include <epicsVersion.h>
 #include <errlog.h>
+#include <initHooks.h>
 #include <menuFtype.h>
 #include <recGbl.h>
 #include <recSup.h>
@@ -155,90 +235,192 @@
 #define NUMBER_OF_ARGS      9
 #define ARG_LENGTH          (NUMBER_OF_ARGS + 2)
 
-/* Normal exit codes are in range 0 to 127
- * These are special case error pseudo exit codes
+/* Number of recent latencies used for the rolling latency percentile.
  */
-#define BASE_EXIT_CODE      128
-#define SETUP_EXIT_CODE     (BASE_EXIT_CODE + 0)
-#define NO_EXEC_EXIT_CODE   (BASE_EXIT_CODE + 1)
-#define TIMEOUT_EXIT_CODE   (BASE_EXIT_CODE + 2)
-#define WAITPID_EXIT_CODE   (BASE_EXIT_CODE + 3)
+#define LATENCY_WINDOW      64
 
-enum PipeIndex {
-   PIPE_READ = 0,
-   PIPE_WRITE,
-   PIPE_SIZE                      /* must be last */
-};
+/* Number of EXECLINK selected programs, with their resolved paths and (if
+ * persistent) workers, kept. The least recently used is evicted.
+ */
+#define EXEC_CACHE_SIZE     4
+#define EXEC_PATH_SIZE      256
+
+/* Number of a persistent worker's first requests whose mean latency is the
+ * baseline for RECYCLE_DRIFT, also the span of the recent latency mean.
+ */
+#define RECYCLE_BASELINE    32
+
+/* Time (seconds) allowed for a replaced persistent worker to exit once asked.
+ */
+#define RETIRE_GRACE        2.1
+
+/* Default maximum number of outstanding detached children, and how often
+ * (seconds) they are polled for completion.
+ */
+#define DETACHED_MAX        8
+#define DETACHED_POLL       0.1
+
+/* Number of balanced STAGGER slots per scan period, and the number of distinct
+ * scan periods for which slots are allocated.
+ */
+#define STAGGER_SLOTS       16
+#define STAGGER_PERIODS     8
+
+/* What is done to warm up the record once the IOC is running.
+ */
+typedef enum WarmupKind {
+   WARMUP_NONE = 0,
+   WARMUP_WORKER,                 /* start the persistent worker */
+   WARMUP_DRY                     /* dry execution with current inputs */
+} WarmupKind;
+
+/* How periodic executions are spread across the scan period.
+ */
+typedef enum StaggerKind {
+   STAGGER_NONE = 0,
+   STAGGER_HASH,                  /* deterministic, from the record name */
+   STAGGER_BALANCED               /* least used slot of the scan period */
+} StaggerKind;
+
+/* Number of records placed in each slot of a scan period.
+ */
+typedef struct StaggerTable {
+   double period;                 /* seconds, 0 if table not in use */
+   int count [STAGGER_SLOTS];
+} StaggerTable;
+
+/* What latency is compared against the LATENCY_MINOR/MAJOR thresholds.
+ */
+typedef enum LatencyBasis {
+   LATENCY_LAST = 0,              /* last execution's end to end time */
+   LATENCY_P95                    /* rolling 95th percentile */
+} LatencyBasis;
+
+/* A persistent worker's age, for the RECYCLE_ policies.
+ */
+typedef struct WorkerAge {
+   epicsUInt32 requests;          /* requests since the worker started */
+   double baseline;               /* mean latency of the first requests (s) */
+   double recent;                 /* exponentially weighted mean latency (s) */
+} WorkerAge;
 
-typedef int HalfDuplexPipe[PIPE_SIZE];
+/* A detached mode child process, outstanding until it exits.
+ */
+typedef struct DetachedChild {
+   asubExecChild child;           /* pid -1 if slot free */
+   asubExecDeadline deadline;     /* terminated if still running beyond this */
+} DetachedChild;
 
-/* Private info allocated to each aSub record instance using this module.
+/* An EXECLINK selected program. Only the current program's worker is held
+ * in ExecInfo, the others are parked here.
+ */
+typedef struct ExecProgram {
+   bool inUse;
+   char name [asubExecStringSize];  /* as read, "" is the EXEC default */
+   char path [EXEC_PATH_SIZE];    /* resolved executable */
+   asubExecChild child;           /* parked persistent worker, pid -1 if none */
+   asubExecPerf perf;
+   WorkerAge age;
+   epicsUInt64 lastUsed;
+} ExecProgram;
+
+/* Private info allocated to each record instance using this module.
  */
 typedef struct ExecInfo {
-   aSubRecord* prec;              /* record reference */
+   ELLNODE node;                  /* must be first - warm up list */
+   dbCommon* prec;                /* record reference */
+   const asubExecBinding* binding;  /* record type's fields */
+   int numberInputs;              /* number of input/output fields in use */
+   int numberOutputs;
    epicsThreadId thread_id;       /* monitor thread id */
    epicsEventId event;            /* monitor thread signal event */
    const char* argv[ARG_LENGTH];  /* arguments 0, 1 .. 9, 10 is NULL */
    double timeOut;                /* max time in seconds that a child process allowed to run */
-   epicsTimeStamp endTime;        /* the end time */
-   pid_t pid;                     /* child process' pid */
-   int fdput;                     /* file desciptor for child process stdin  - we write to it */
-   int fdget;                     /* file desciptor for child process stdout - we read from it */
-   int exitCode;                  /* child process' exit code */
+   asubExecBackend backend;       /* how the child process is created */
+   int execLink;                  /* EXECLINK input index, -1 if EXEC only */
+   const char* execDefault;       /* EXEC, used when the EXECLINK input is empty */
+   const char* execAllow;         /* EXECALLOW, space separated, NULL if none */
+   ExecProgram programs [EXEC_CACHE_SIZE];
+   int program;                   /* current program index, -1 if none */
+   epicsUInt64 programClock;      /* for lastUsed */
+   asubExecChild child;           /* child process' pid, pipes and exit code */
+   bool persistent;               /* child process is a long running worker */
+   bool detached;                 /* complete once the input has been handed off */
+   int detachedMax;               /* DETACHED_MAX */
+   int detachedCount;             /* outstanding detached children */
+   DetachedChild* detachedChildren;  /* detachedMax slots */
+   epicsUInt32 requestTag;        /* last persistent worker request tag */
+   WorkerAge age;                 /* current worker's age */
+   epicsUInt32 recycleRequests;   /* RECYCLE_ limits, 0 if none */
+   epicsUInt64 recycleRss;        /* bytes */
+   double recycleDrift;           /* factor over baseline latency */
+   bool recycleDue;               /* replace the worker after this execution */
+   asubExecChild standby;         /* replacement worker, pid -1 if none */
+   asubExecPerf standbyPerf;
+   epicsUInt64 standbyTime;       /* time the ready probe was sent */
+   asubExecChild retiring;        /* replaced worker, pid -1 if none */
+   epicsUInt64 retiringTime;      /* time the replaced worker was asked to exit */
+   WarmupKind warmup;
+   bool warmupRequested;          /* set (with pact) when warm up is due */
+   epicsCallback warmupCallback;
+   bool singleflight;             /* share identical concurrent executions */
+   epicsEventId sharedEvent;      /* signalled when a shared execution completes */
+   bool perfEnabled;              /* attach perf counters to child processes */
+   bool perfWarned;               /* perf counters unavailable reported */
+   asubExecPerf perf;             /* current child process' counters */
+   uint64_t perfBase [asubExecPerfCount];  /* counts as at execution start */
+   asubExecDataType inputTypes [asubExecMaxFields];  /* INTYPE_x, None if as is */
+   const asubExecSlice* slices [asubExecMaxFields];  /* ROI_x, NULL if none */
+   const asubExecTransform* transforms [asubExecMaxFields];  /* POST_x, NULL if none */
    long status;                   /* return status to record processing */
+   asubExecTrace trace;           /* current/last execution trace */
+   asubExecStats* stats;          /* performance statistics */
+   double latencyMinor;           /* latency alarm thresholds (s), 0 if none */
+   double latencyMajor;
+   LatencyBasis latencyBasis;
+   double latencyWindow [LATENCY_WINDOW];  /* recent latencies (s) */
+   int latencyCount;              /* total latencies added to window */
+   epicsEnum16 latencySevr;       /* latency alarm severity for last execution */
+   double maxRate;                /* token bucket rate (Hz), 0 if unlimited */
+   double maxBurst;               /* token bucket capacity */
+   double tokens;
+   epicsUInt64 tokenTime;         /* time tokens last added */
+   epicsCallback deferCallback;  /* re-processes the record when a token is due */
+   epicsCallback releaseCallback;   /* ends the hold on a deferred request */
+   bool deferPending;             /* deferred re-process scheduled */
+   bool deferHeld;                /* pact held only to skip monitors/forward link */
+   StaggerKind stagger;
+   double staggerSpan;            /* fraction of the scan period used */
+   double staggerFraction;        /* phase, as a fraction of the span */
+   double staggerPeriod;          /* period the phase was placed for, if balanced */
+   StaggerTable* staggerTable;    /* balanced placement table and slot, NULL if none */
+   int staggerSlot;
+   epicsCallback staggerCallback;
+   asubExecBuffer input;          /* encoded input frame */
+   asubExecBuffer output;         /* raw response frame */
+   asubExecBlob* response;        /* shared response frame, used instead of output */
+   bool capturing;                /* capture this execution */
+   epicsUInt32 captureGeneration; /* see asubExecCaptureSelected */
+   bool captureSelected;
 } ExecInfo;
 
 
 static int asubExecDebug = 0;     /* exported to IOC shell */
+static double asubExecWarmupSpacing = 0.1;   /* exported to IOC shell */
 static bool iocIsRunning = true;
 
+static ELLLIST warmupList = ELLLIST_INIT;
+static bool warmupHookRegistered = false;
 
-/*------------------------------------------------------------------------------
- */
-static char* now() {
-   struct timeval theTime;           // essentially secs and usecs.
-   struct tm bt;                     // broken-down time
-
-   gettimeofday(&theTime, NULL);
-   localtime_r(&theTime.tv_sec, &bt);
-
-   static char buffer [24];
-
-   int mSec = theTime.tv_usec / 1000;
-   snprintf(buffer, sizeof(buffer), "%02d:%02d:%02d.%03d",
-            bt.tm_hour, bt.tm_min, bt.tm_sec, mSec);
-   return buffer;
-}
-
-/*------------------------------------------------------------------------------
- * Extend perror to be like printf
- */
-static void perrorf (const char* function,
-                     const int line_no,
-                     const char* format, ...)
-{
-   static const char* red   = "\033[31;1m";
-   static const char* reset = "\033[00m";
-
-   char message1 [200];
-   char message2 [240];
-   va_list arguments;
-   va_start (arguments, format);
-   vsnprintf (message1, sizeof (message1), format, arguments);
-   va_end (arguments);
-   snprintf (message2, sizeof (message2), "%s asubExec::%s:%d %s%s%s",
-             now(), function, line_no, red, message1, reset);
-   perror (message2);
-}
-
-#define PERRORF(...) perrorf (   __FUNCTION__, __LINE__, __VA_ARGS__);
+static StaggerTable staggerTables [STAGGER_PERIODS];
+static epicsMutexId staggerLock = NULL;
 
 
 /*------------------------------------------------------------------------------
  * Wrapper function around printf/errlogPrintf.
  */
 static void devprintf (const int requiredDebug,
-                       aSubRecord* prec,
+                       dbCommon* prec,
                        const char* function,
                        const char* format, ...)
 {
@@ -253,23 +435,23 @@ static void devprintf (const int requiredDebug,
       if (requiredDebug >= 2) {
          // Console only.
          //
-         printf ("%s (%s) asubExec.%s: %s", now(), prec->name, function, message);
+         printf ("%s (%s) asubExec.%s: %s", asubExecTimeOfDay (), prec->name, function, message);
       } else {
          // Errors and warnings: console and the IOC logger.
          //
-         errlogPrintf ("%s (%s) %s: %s", now(), prec->name, function, message);
+         errlogPrintf ("%s (%s) %s: %s", asubExecTimeOfDay (), prec->name, function, message);
       }
    }
 }
 
 /*------------------------------------------------------------------------------
  * Wrapper macros to devprintf.
- * aSubRecord* prec  must be in scope.
+ * dbCommon* prec  must be in scope.
  */
-#define ERROR(...)    devprintf (0, prec,__FUNCTION__, __VA_ARGS__);
-#define WARN(...)     devprintf (1, prec,__FUNCTION__, __VA_ARGS__);
-#define INFO(...)     devprintf (2, prec,__FUNCTION__, __VA_ARGS__);
-#define DETAIL(...)   devprintf (3, prec,__FUNCTION__, __VA_ARGS__);
+#define ERROR(...)    devprintf (0, (dbCommon*) prec,__FUNCTION__, __VA_ARGS__);
+#define WARN(...)     devprintf (1, (dbCommon*) prec,__FUNCTION__, __VA_ARGS__);
+#define INFO(...)     devprintf (2, (dbCommon*) prec,__FUNCTION__, __VA_ARGS__);
+#define DETAIL(...)   devprintf (3, (dbCommon*) prec,__FUNCTION__, __VA_ARGS__);
 
 
 /*------------------------------------------------------------------------------
@@ -278,7 +460,7 @@ static void devprintf (const int requiredDebug,
  * Convert from EPICS menuFtype to asubExecDataType which we will ensure we
  * alway have fixed values.
  */
-static asubExecDataType menuFtype2asubExecDataType (const menuFtype type)
+asubExecDataType menuFtype2asubExecDataType (const int type)
 {
    switch (type) {
       case menuFtypeSTRING: return asubExecTypeSTRING;
@@ -326,20 +508,10 @@ static menuFtype asubExecDataType2menuFtype (const asubExecDataType type)
 }
 
 
-/*------------------------------------------------------------------------------
- * Perform and immediate process exit.
- */
-static void childExit (const int status)
-{
-   /* Don't run our parent's atexit() handlers.
-    */
-   _exit (status);
-}
-
 
 /*------------------------------------------------------------------------------
  * Macro function - perform standard sanity checks.
- * Assumes function has an aSubRecord* prec parameter or similar.
+ * Assumes function has a dbCommon* prec parameter or similar.
  * NOTE: Auto declares ExecInfo* pExecInfo
  */
 #define STANDARD_CHECK(errorReturnValue)                                       \
@@ -360,7 +532,7 @@ if (!pExecInfo) {                                                              \
  */
 static void shutdown (void* item)
 {
-   aSubRecord* prec = (aSubRecord*) item;
+   dbCommon* prec = (dbCommon*) item;
    STANDARD_CHECK ();
    iocIsRunning = false;
    epicsEventSignal (pExecInfo->event);      /* wake up thread */
@@ -368,623 +540,1050 @@ static void shutdown (void* item)
 
 
 /*------------------------------------------------------------------------------
- * Creates and starts the child process.
- * Returns true if and only if successfull.
- * NOTE: any child process std err output gets direted to the IOC shell console.
+ * aSub binding - fields A, B, ... U and VALA, VALB, ... VALU.
+ *------------------------------------------------------------------------------
  */
-static bool startChildProcess (aSubRecord* prec)
+static void aSubKey (const int j, char* key, const size_t size)
 {
-   STANDARD_CHECK (false);
+   snprintf (key, size, "%c", (char) ((int) 'A' + j));
+}
 
-   pid_t pid;
-   int status;
-   HalfDuplexPipe input_data;
-   HalfDuplexPipe output_data;
+/*------------------------------------------------------------------------------
+ */
+static void aSubCount (dbCommon* pcommon, int* numberInputs, int* numberOutputs)
+{
+   *numberInputs = NUMBER_IO_FIELDS;
+   *numberOutputs = NUMBER_IO_FIELDS;
+}
 
-   /* Ensure not erroneous
-    */
-   pExecInfo->pid = -1;
-   pExecInfo->fdput = -1;
-   pExecInfo->fdget = -1;
-   pExecInfo->exitCode = -1;
+/*------------------------------------------------------------------------------
+ * Describe input fields A, B, ... U and output fields VALA, VALB, ... VALU
+ * for the execution engine.
+ */
+static void aSubDescribe (dbCommon* pcommon, asubExecField inputs[],
+                          asubExecField outputs[])
+{
+   aSubRecord* prec = (aSubRecord*) pcommon;
+   int j;
 
-   /* Create pipes to comunicate with child process.
-    */
-   status = pipe (input_data);
-   if (status != 0) {
-      PERRORF ("pipe (input_data)");
-      return false;
-   }
+   for (j = 0; j < NUMBER_IO_FIELDS; j++) {
+      inputs[j].type = menuFtype2asubExecDataType ((&prec->fta)[j]);
+      inputs[j].number = (&prec->noa)[j];
+      inputs[j].data = (&prec->a)[j];
 
-   status = pipe (output_data);
-   if (status != 0) {
-      PERRORF ("pipe (output_data)");
-      return false;
+      outputs[j].type = menuFtype2asubExecDataType ((&prec->ftva)[j]);
+      outputs[j].number = (&prec->nova)[j];
+      outputs[j].data = (&prec->vala)[j];
    }
+}
 
-   /* Create child process
-    */
-   pid = fork ();
-   if (pid < 0) {
-      /* We have had a forking error. */
-      PERRORF ("fork ()");
-      return false;
-   }
+static const asubExecBinding aSubBinding = {
+   false, "INP", "FT", "FTV", "NOV", "VAL", aSubKey, aSubCount, aSubDescribe, NULL, NULL
+};
 
-   /* Are we the child or the parent process?
-    */
-   if (pid == 0) {
-      /* We are the child.
-       */
-      sigset_t emptyMask;
-      int status;
-      int fd;
-      int maxfd;
-
-      /* Reset which signals are blocked. The child process inherites these
-       * from the EPICS IOC. We need a "clean" slate, in particular, so that
-       * the child process will respond to a SIGTERM signal.
-       * The child process is free to catch SIGTERM if needs be.
-       */
-      sigemptyset (&emptyMask);
-      status = sigprocmask (SIG_SETMASK, &emptyMask, NULL);
-      if (status != 0) {
-         PERRORF ("sigprocmask ()");
-         childExit (SETUP_EXIT_CODE);
-      }
+/*------------------------------------------------------------------------------
+ * Record independent functions
+ *------------------------------------------------------------------------------
+ */
 
-      /* Connect standard IO to the pipes.
-       * Duplicate file descriptors to standard in/out
-       */
-      fd = dup2 (input_data[PIPE_READ], STDIN_FILENO);
-      if (fd != STDIN_FILENO) {
-         PERRORF ("dup2 (stdin)");
-         childExit (SETUP_EXIT_CODE);
-      }
+/*------------------------------------------------------------------------------
+ * Decodes the response into the output fields and reports any mis-matches.
+ * Returns true if and only if successfull.
+ */
+static bool decodeOutputs (dbCommon* prec, const asubExecField outputs[])
+{
+   STANDARD_CHECK (false);
 
-      fd = dup2 (output_data[PIPE_WRITE], STDOUT_FILENO);
-      if (fd != STDOUT_FILENO) {
-         PERRORF ("dup2 (stdin)");
-         childExit (SETUP_EXIT_CODE);
-      }
+   const asubExecBinding* binding = pExecInfo->binding;
+   asubExecField received [asubExecMaxFields];
+   asubExecTransformCounts counts [asubExecMaxFields];
+   epicsUInt64 clamped = 0;
+   epicsUInt64 nans = 0;
+   asubExecStatus status;
+   int j;
 
-      /* from posix/osdProcess.c
-       * close all open files except for STDIO so they will not be inherited
-       * by the spawned process. This includes the unused pipe descriptors.
-       *
-       * We "know" standard file descriptors are 0, 1 and 2
-       */
-      maxfd = sysconf (_SC_OPEN_MAX);
-      for (fd = 3; fd <= maxfd; fd++) {
-         close (fd);
-      }
+   memset (counts, 0, pExecInfo->numberOutputs * sizeof (counts[0]));
 
-      /* Now exec to new process.
-       */
-      pExecInfo->argv [ARG_LENGTH - 1] = NULL;  /* belts 'n' braces */
+   const asubExecBlob* response = pExecInfo->response;
+   status = asubExecDecodeWith (response ? response->data : pExecInfo->output.data,
+                                response ? response->size : pExecInfo->output.size,
+                                outputs, pExecInfo->numberOutputs, received,
+                                pExecInfo->transforms, counts);
+   if (status != asubExecOkay) {
+      ERROR ("response %s\n", asubExecStatusText (status));
+      return false;
+   }
 
-      /* Caste to get rid of that pesky warning.
-       */
-      status = execvp (pExecInfo->argv[0], (char *const *) pExecInfo->argv);
+   for (j = 0; j < pExecInfo->numberOutputs; j++) {
+      clamped += counts[j].clamped;
+      nans += counts[j].nans;
+   }
+   asubExecStatsTransform (pExecInfo->stats, clamped, nans);
+
+   for (j = 0; j < pExecInfo->numberOutputs; j++) {
+      char key [4];  /* for diagnostic outputs */
+      binding->key (j, key, sizeof (key));
+
+      if (received[j].type != outputs[j].type) {
+         if (asubExecTypeIsNumeric (received[j].type) &&
+             asubExecTypeIsNumeric (outputs[j].type)) {
+            WARN ("%s%s converted from: %d, to: %d\n", binding->outputTypeName, key,
+                  asubExecDataType2menuFtype (received[j].type),
+                  asubExecDataType2menuFtype (outputs[j].type));
+         } else {
+            /* string/number mis-match - discarded
+             */
+            ERROR ("%s%s mis-match expected: %d, actual %d\n", binding->outputTypeName, key,
+                   asubExecDataType2menuFtype (outputs[j].type),
+                   asubExecDataType2menuFtype (received[j].type));
+            continue;
+         }
+      }
 
-      /* The exec call failed - it returned - this is unexpected.
-       */
-      PERRORF ("execvp (\"%s\", ...) -> %d", pExecInfo->argv[0], status);
-      childExit (NO_EXEC_EXIT_CODE);    /** does not return - most important **/
+      if (received[j].number != outputs[j].number) {
+         WARN ("%s%s size mis-match expected: %d, actual: %d\n", binding->outputNumberName,
+               key, outputs[j].number, received[j].number);
+      }
    }
 
-   /* We are the parent. Save the child process id.
-    */
-   pExecInfo->pid = pid;
+   if (binding->decoded) binding->decoded (prec, received);
 
-   INFO ("%s (pid=%d) starting\n", pExecInfo->argv[0], pExecInfo->pid);
+   return true;
+}
 
-   /* Save file pipe file descriptors and close unused pipe ends.
-    */
-   pExecInfo->fdput = input_data[PIPE_WRITE];
-   status = close (input_data[PIPE_READ]);
-   if (status != 0) {
-      PERRORF ("close  (input_data [in])");
-   }
+/*------------------------------------------------------------------------------
+ * Accumulates the child process' perf counts since the execution started.
+ */
+static void accumulatePerf (dbCommon* prec)
+{
+   STANDARD_CHECK ();
 
-   pExecInfo->fdget = output_data[PIPE_READ];
-   status = close (output_data[PIPE_WRITE]);
-   if (status != 0) {
-      PERRORF ("close  (output_data [out])");
-   }
+   uint64_t values [asubExecPerfCount];
+   int k;
 
-   /* Set put/get files non blocking - we need to be able to kill the
-    * child process if it exceeds allowed time and/or monitor IOC shutdown
-    * requests.
-    */
-   int flags;
+   if (!pExecInfo->perfEnabled) return;
 
-   flags = fcntl (pExecInfo->fdput, F_GETFL, 0);
-   flags |= O_NONBLOCK;
-   flags = fcntl (pExecInfo->fdput, F_SETFL, flags);
+   if (!asubExecPerfIsOpen (&pExecInfo->perf)) {
+      if (!pExecInfo->perfWarned) {
+         WARN ("perf counters unavailable, see perf_event_paranoid\n");
+         pExecInfo->perfWarned = true;
+      }
+      return;
+   }
 
-   flags = fcntl (pExecInfo->fdget, F_GETFL, 0);
-   flags |= O_NONBLOCK;
-   flags = fcntl (pExecInfo->fdget, F_SETFL, flags);
+   asubExecPerfRead (&pExecInfo->perf, values);
+   for (k = 0; k < asubExecPerfCount; k++) {
+      const uint64_t total = values[k];
+      values[k] = total - pExecInfo->perfBase[k];
+      pExecInfo->perfBase[k] = total;
+   }
 
-   /* Lastly calculate timeout/end time beyond which the child process
-    * will be terminated.
-    */
-   epicsTimeGetCurrent (&pExecInfo->endTime);
-   epicsTimeAddSeconds (&pExecInfo->endTime, pExecInfo->timeOut);
+   asubExecStatsPerf (pExecInfo->stats, values);
 
-   return true;
+   DETAIL ("cycles %llu, instructions %llu, task clock %.6fs\n",
+           (unsigned long long) values[asubExecPerfCycles],
+           (unsigned long long) values[asubExecPerfInstructions],
+           (double) values[asubExecPerfTaskClock] * 1.0e-9);
 }
 
-
 /*------------------------------------------------------------------------------
- * Wait for and/or kill the child process.
+ * Runs a child process for this one execution: spawn, write the input frame,
+ * read the response and reap.
  */
-static void waitChildProcess (aSubRecord* prec, const bool immediate)
+static asubExecStatus executeChild (dbCommon* prec)
 {
-   STANDARD_CHECK ();
+   STANDARD_CHECK (asubExecIoError);
 
-   static const double dt = 0.005;
+   asubExecChild* child = &pExecInfo->child;
+   asubExecDeadline deadline;
+   asubExecStatus status;
 
-   /* Calculated term/kill times
-    * We allow 0.1s wiggle roon before issing SIGTERM, after which we allow a
-    * further 2 seconds for the process to terminate before issing a SIGKILL.
-    */
-   epicsTimeStamp termTime;
-   epicsTimeStamp killTime;
-   bool sigTermIssued;
+   ASUB_EXEC_PROBE1 (spawn_start, prec->name);
 
-   epicsTimeGetCurrent (&termTime);
-   epicsTimeAddSeconds (&termTime, 0.1);
+   if (!asubExecChildStartPerf (child, pExecInfo->backend, pExecInfo->argv,
+                                pExecInfo->perfEnabled ? &pExecInfo->perf : NULL)) {
+      return asubExecIoError;
+   }
+   memset (pExecInfo->perfBase, 0, sizeof (pExecInfo->perfBase));
+
+   pExecInfo->trace.pid = child->pid;
+   pExecInfo->trace.time [asubExecPhaseSpawned] = asubExecTraceNow ();
 
-   epicsTimeGetCurrent (&killTime);
-   epicsTimeAddSeconds (&killTime, 2.1);
+   ASUB_EXEC_PROBE2 (spawn_end, prec->name, child->pid);
 
-   sigTermIssued = false;
+   INFO ("%s (pid=%d) starting\n", pExecInfo->argv[0], child->pid);
 
-   /* Monitor the child process
+   /* Calculate timeout/end time beyond which the child process will be terminated.
     */
-   while (iocIsRunning) {
-      epicsThreadSleep (dt);
-      if (!iocIsRunning) break;
+   asubExecDeadlineSet (&deadline, pExecInfo->timeOut);
 
-      /* Wait for process to change state.
-       */
-      int status;
-      pid_t pid = waitpid (pExecInfo->pid, &status, WNOHANG);
-
-      if (pid == pExecInfo->pid) {
-         /* Child process is complete - simple.
-          */
-         INFO ("child process complete\n");
-         pExecInfo->exitCode = WEXITSTATUS (status);
-         break;
-      }
+   /* Send the input to the child process.
+    * We write all the output data before reading any input data.
+    * The rules of the game are that the nonminated program/script should
+    * consume all its input before processing and generating any significant
+    * amount of output.  The pipes provide some leeway here.
+    */
+   ASUB_EXEC_PROBE2 (write_start, prec->name, child->pid);
 
-      if (pid != 0) {
-         /* an unexpected return value occured, either an error or another pid.
-          */
-         PERRORF ("waitpid");
-         ERROR ("waitpid (%d) => %d, status = %d\n", pExecInfo->pid, pid, status);
+   status = asubExecChildWrite (child, pExecInfo->input.data, pExecInfo->input.size,
+                                &deadline, &iocIsRunning);
 
-         pExecInfo->exitCode = WAITPID_EXIT_CODE;
-         break;
-      }
+   pExecInfo->trace.time [asubExecPhaseWritten] = asubExecTraceNow ();
+   pExecInfo->trace.bytesIn = (status == asubExecOkay) ? pExecInfo->input.size : 0;
 
-      /* pid == 0 - still waiting for child process to complete.
-       */
-      DETAIL ("child process still running\n");
+   ASUB_EXEC_PROBE3 (write_end, prec->name, child->pid, (long) pExecInfo->trace.bytesIn);
 
-      /* Has the allowed time expired ?
-       */
-      epicsTimeStamp timeNow;
-      epicsTimeGetCurrent (&timeNow);
-      if (epicsTimeLessThan (&timeNow, &termTime)) continue;
+   if (status != asubExecOkay) {
+      INFO ("write %s\n", asubExecStatusText (status));
+   }
+   INFO ("wrote %d bytes\n", (int) pExecInfo->trace.bytesIn);
 
-      if (!sigTermIssued) {
-         /* Timeout - shutdown child process.
-          */
-         INFO ("child process timeout\n");
+   /* Read the whole response - it is unpacked once the child is reaped.
+    */
+   ASUB_EXEC_PROBE2 (read_start, prec->name, child->pid);
 
-         /* First ask nicely, then allow 2 seconds fopr orderly shutdown.
-          */
-         INFO ("sending SIGTERM to pid %d\n", pExecInfo->pid);
+   status = asubExecChildRead (child, &pExecInfo->output, pExecInfo->numberOutputs,
+                               &deadline, &iocIsRunning);
 
-         status = kill (pExecInfo->pid, SIGTERM);
-         pExecInfo->exitCode = TIMEOUT_EXIT_CODE;
+   ASUB_EXEC_PROBE3 (read_end, prec->name, child->pid, (long) pExecInfo->output.size);
 
-         sigTermIssued = true;
-         continue;
-      }
+   pExecInfo->trace.time [asubExecPhaseRead] = asubExecTraceNow ();
+   pExecInfo->trace.bytesOut = pExecInfo->output.size;
 
-      /* Allow a bit extra time/wiggle room before we issue a kill order
-       */
-      if (epicsTimeLessThan (&timeNow, &killTime)) continue;
+   INFO ("read %d bytes\n", (int) pExecInfo->output.size);
+   INFO ("%s (pid=%d) complete\n", pExecInfo->argv[0], child->pid);
 
-      /* No more Mr. Nice Guy ...
-       */
-      INFO ("sending SIGKILL to pid %d\n", pExecInfo->pid);
+   /* We allow 0.1s wiggle room before issuing SIGTERM, after which we allow a
+    * further 2 seconds for the process to terminate before issuing a SIGKILL.
+    */
+   asubExecChildReap (child, 0.1, 2.1, &iocIsRunning);
+
+   if (child->killIssued) {
+      INFO ("process (pid=%d) killed\n", child->pid);
+   } else if (child->termIssued) {
+      INFO ("process (pid=%d) terminated\n", child->pid);
+   }
 
-      kill (pExecInfo->pid, SIGKILL);
-      pExecInfo->exitCode = TIMEOUT_EXIT_CODE;
+   pExecInfo->trace.time [asubExecPhaseReaped] = asubExecTraceNow ();
 
-      waitpid (pExecInfo->pid, &status, 0);
+   ASUB_EXEC_PROBE3 (reap, prec->name, child->pid, child->exitCode);
 
-      INFO ("process (pid=%d) killed\n", pExecInfo->pid);
+   INFO ("process exit code: %d\n", child->exitCode);
 
-      pExecInfo->exitCode = TIMEOUT_EXIT_CODE;
-      break;
-   }
+   accumulatePerf (prec);
+   asubExecPerfClose (&pExecInfo->perf);
+
+   return status;
 }
 
 /*------------------------------------------------------------------------------
- * A wrapper around the write function to check for IOC termination, timeout
- * and would be blocking "errors".
+ * Persistent worker start and stop.
  */
-ssize_t writeWrapper (aSubRecord* prec, const void* buffer, const size_t count)
+static bool startWorker (dbCommon* prec)
 {
-   static const double dt = 0.005;
+   STANDARD_CHECK (false);
 
-   STANDARD_CHECK (-1);
+   asubExecChild* child = &pExecInfo->child;
 
-   ssize_t numBytes;   /* result */
+   if (!asubExecChildStartPerf (child, pExecInfo->backend, pExecInfo->argv,
+                                pExecInfo->perfEnabled ? &pExecInfo->perf : NULL)) {
+      child->pid = -1;
+      return false;
+   }
 
-   while (true) {
-      /* Has the IOC has stopped running ?
-       */
-      if (!iocIsRunning) {
-         INFO ("IOC terminated\n");
-         numBytes = -1;
-         break;
-      }
+   memset (&pExecInfo->age, 0, sizeof (pExecInfo->age));
 
-      /* Has the allowed time expired ?
-       */
-      epicsTimeStamp timeNow;
-      epicsTimeGetCurrent (&timeNow);
-      if (epicsTimeGreaterThan (&timeNow, &pExecInfo->endTime)) {
-         INFO ("child process timeout\n");
-         numBytes = -2;
-         break;
-      }
+   INFO ("%s (pid=%d) worker started\n", pExecInfo->argv[0], child->pid);
+   return true;
+}
 
-      /* The IOC is still running and no timeout - try an actual write.
-       */
-      numBytes = write (pExecInfo->fdput, buffer, count);
-      if (numBytes >= 0) {
-         /* the write went okay */
-         break;
-      }
+static void stopWorker (dbCommon* prec)
+{
+   STANDARD_CHECK ();
 
-      const int theError = errno;
-      if ((theError != EAGAIN) && (theError != EWOULDBLOCK)) {
-         /* This is an actual error
-          */
-         PERRORF ("write (,, %d)", (int) count);
-         break;
-      }
+   asubExecChild* child = &pExecInfo->child;
+   if (child->pid <= 0) return;
 
-      /* Sleep a while and try again.
-       */
-      DETAIL ("writeWrapper: epicsThreadSleep\n");
-      epicsThreadSleep (dt);
-   }
+   /* Closing stdin asks the worker to exit.
+    */
+   asubExecChildClose (child);
+   asubExecChildReap (child, 0.1, 2.1, &iocIsRunning);
 
-   return numBytes;
+   INFO ("worker (pid=%d) stopped, exit code: %d\n", child->pid, child->exitCode);
+   child->pid = -1;
+   asubExecPerfClose (&pExecInfo->perf);
 }
 
-
 /*------------------------------------------------------------------------------
- * A wrapper around the read function to check for IOC termination, timeout
- * and would be blocking "errors".
+ * Updates the worker's age with this request's latency, and determines if the
+ * worker is due to be recycled as per the RECYCLE_ policies.
  */
-ssize_t readWrapper (aSubRecord* prec, void* buffer, const size_t count)
+static void ageWorker (dbCommon* prec, const double latency)
 {
-   static const double dt = 0.005;
+   STANDARD_CHECK ();
 
-   STANDARD_CHECK (-1);
+   WorkerAge* age = &pExecInfo->age;
+   const char* reason = NULL;
+   uint64_t rss = 0;
 
-   ssize_t numBytes;   /* result */
+   age->requests++;
+   if (age->requests <= RECYCLE_BASELINE) {
+      age->baseline += (latency - age->baseline) / (double) age->requests;
+      age->recent = age->baseline;
+   } else {
+      age->recent += (latency - age->recent) / (double) RECYCLE_BASELINE;
+   }
 
-   while (true) {
-      /* Has the IOC has stopped running ?
-       */
-      if (!iocIsRunning) {
-         INFO ("IOC terminated\n");
-         numBytes = -1;
-         break;
-      }
+   if (pExecInfo->recycleRequests > 0 && age->requests >= pExecInfo->recycleRequests) {
+      reason = "request count";
+   } else if (pExecInfo->recycleRss > 0 && asubExecChildRss (&pExecInfo->child, &rss) &&
+              rss > pExecInfo->recycleRss) {
+      reason = "RSS";
+   } else if (pExecInfo->recycleDrift > 0.0 && age->requests > RECYCLE_BASELINE &&
+              age->recent > pExecInfo->recycleDrift * age->baseline) {
+      reason = "latency drift";
+   }
 
-      /* Has the allowed time expired ?
-       */
-      epicsTimeStamp timeNow;
-      epicsTimeGetCurrent (&timeNow);
-      if (epicsTimeGreaterThan (&timeNow, &pExecInfo->endTime)) {
-         INFO ("child process timeout\n");
-         numBytes = -2;
-         break;
-      }
+   if (reason && !pExecInfo->recycleDue && pExecInfo->standby.pid <= 0) {
+      INFO ("worker (pid=%d) due for recycling: %s after %u requests\n",
+            pExecInfo->child.pid, reason, age->requests);
+      pExecInfo->recycleDue = true;
+   }
+}
 
-      /* The IOC is still running and no timeout - try an actual read.
-       */
-      numBytes = read (pExecInfo->fdget, buffer, count);
-      if (numBytes >= 0) {
-         /* the read went okay - albeit 0 read for end of input */
-         /* TODO: check for numBytes < count  - go round the loop */
-         break;
-      }
+/*------------------------------------------------------------------------------
+ * Reaps the retired worker, if it has exited. A retired worker still running
+ * RETIRE_GRACE seconds after being asked to exit is terminated, waiting at most
+ * a further 0.1s.
+ */
+static void reapRetired (dbCommon* prec)
+{
+   STANDARD_CHECK ();
 
-      const int theError = errno;
-      if ((theError != EAGAIN) && (theError != EWOULDBLOCK)) {
-         /* This is an actual error
-          */
-         PERRORF ("read (,, %d)", (int) count);
-         break;
-      }
+   asubExecChild* retiring = &pExecInfo->retiring;
+   if (retiring->pid <= 0) return;
 
-      /* Sleep a while and try again.
-       */
-      DETAIL("epicsThreadSleep\n");
-      epicsThreadSleep (dt);
+   if (!asubExecChildPoll (retiring)) {
+      const double waited = (double) (asubExecTraceNow () - pExecInfo->retiringTime) * 1.0e-9;
+      if (waited < RETIRE_GRACE) return;
+      asubExecChildReap (retiring, 0.0, 0.1, &iocIsRunning);
    }
 
-   return numBytes;
+   INFO ("retired worker (pid=%d) exit code: %d\n", retiring->pid, retiring->exitCode);
+   retiring->pid = -1;
 }
 
-
 /*------------------------------------------------------------------------------
- * Encodes input fields A, B, ... U and writes data to child process.
- * Also encodes info about the output fields (type and max elements).
+ * Retires the standby worker, e.g. if it failed to become ready.
  */
-static ssize_t encodeAndWriteInputs (aSubRecord* prec)
+static void abandonStandby (dbCommon* prec, const char* reason)
 {
-   ssize_t total;
-   ssize_t numBytes;
-   int j;
+   STANDARD_CHECK ();
 
-   total = 0;
+   asubExecChild* standby = &pExecInfo->standby;
+   if (standby->pid <= 0) return;
 
-   /* First house keeping - magic word and version.
-    */
-   numBytes = writeWrapper (prec, asubExecStx, strnlen(asubExecStx, 80));
-   total += numBytes;
+   WARN ("replacement worker (pid=%d) abandoned: %s\n", standby->pid, reason);
 
-   const epicsUInt32 version = asubExecVersion;
-   numBytes = writeWrapper (prec, &version, sizeof(version));
-   total += numBytes;
+   asubExecChildClose (standby);
+   asubExecPerfClose (&pExecInfo->standbyPerf);
+   pExecInfo->retiring = *standby;
+   pExecInfo->retiringTime = asubExecTraceNow ();
+   standby->pid = -1;
+}
 
-   for (j = 0; j < NUMBER_IO_FIELDS; j++) {
-      const menuFtype inputType = (&prec->fta)[j];
-      const epicsInt16 extFieldType = menuFtype2asubExecDataType (inputType);
-      const epicsUInt32 number = (&prec->noa)[j];
-      const void *data = (&prec->a)[j];
-      const long elementSize = dbValueSize (inputType);
-
-      numBytes = writeWrapper (prec, &extFieldType, sizeof (extFieldType));
-      if (numBytes < 0)
-         break;
-      total += numBytes;
+/*------------------------------------------------------------------------------
+ * Starts the worker's replacement as a standby and sends it a ready probe. The
+ * current worker continues to serve requests until the standby has answered,
+ * see promoteStandby. The replacement is not started while a previously
+ * replaced worker is still exiting, so that neither has to be waited for.
+ */
+static void recycleWorker (dbCommon* prec)
+{
+   STANDARD_CHECK ();
 
-      numBytes = writeWrapper (prec, &number, sizeof (number));
-      if (numBytes < 0)
-         break;
-      total += numBytes;
+   asubExecChild* standby = &pExecInfo->standby;
+   asubExecDeadline deadline;
 
-      numBytes = writeWrapper (prec, data, number * elementSize);
-      if (numBytes < 0)
-         break;
-      total += numBytes;
+   if (pExecInfo->child.pid <= 0) {
+      pExecInfo->recycleDue = false;
+      return;
    }
 
-   /* And encode the expected output format.
-    * Like above, but no data - just type and number of elements.
+   /* Already replacing, or still retiring - try again after the next execution.
     */
-   for (j = 0; j < NUMBER_IO_FIELDS; j++) {
-      const menuFtype outputType = (&prec->ftva)[j];
-      const epicsInt16 extFieldType = menuFtype2asubExecDataType (outputType);
-      const epicsUInt32 number = (&prec->nova)[j];
-
-      numBytes = writeWrapper (prec, &extFieldType, sizeof (extFieldType));
-      if (numBytes < 0)
-         break;
-      total += numBytes;
-
-      numBytes = writeWrapper (prec, &number, sizeof (number));
-      if (numBytes < 0)
-         break;
-      total += numBytes;
+   if (standby->pid > 0) return;
+   reapRetired (prec);
+   if (pExecInfo->retiring.pid > 0) return;
+
+   pExecInfo->recycleDue = false;
+
+   asubExecPerfInit (&pExecInfo->standbyPerf);
+   if (!asubExecChildStartPerf (standby, pExecInfo->backend, pExecInfo->argv,
+                                pExecInfo->perfEnabled ? &pExecInfo->standbyPerf : NULL)) {
+      WARN ("replacement worker failed to start, retaining pid=%d\n", pExecInfo->child.pid);
+      standby->pid = -1;
+      return;
    }
 
-   /* And lastly terminate data stream.
-    */
-   numBytes = writeWrapper (prec, asubExecEtx, strnlen(asubExecEtx, 80));
-   total += numBytes;
+   asubExecDeadlineSet (&deadline, pExecInfo->timeOut);
+   if (asubExecChildSendReady (standby, 0, &deadline, &iocIsRunning) != asubExecOkay) {
+      abandonStandby (prec, "ready probe not sent");
+      return;
+   }
+   pExecInfo->standbyTime = asubExecTraceNow ();
 
-   return total;
+   INFO ("%s (pid=%d) replacement worker started\n", pExecInfo->argv[0], standby->pid);
 }
 
 /*------------------------------------------------------------------------------
- * Reads data from the child process and decodes into fields VALA, VALB, ... VALU
+ * Replaces the worker with the standby once the standby has answered the ready
+ * probe. The replaced worker is asked to exit, by closing its stdin, and is
+ * reaped once it has exited. Non blocking.
  */
-static ssize_t readAndDecodeOutputs(aSubRecord* prec)
+static void promoteStandby (dbCommon* prec)
 {
-   const size_t stxLen = strnlen(asubExecStx, 80);
-   const size_t etxLen = strnlen(asubExecEtx, 80);
-
-   ssize_t total;
-   ssize_t numBytes;
-   int j;
-
-   /* Unpack the response.
-    */
-   total = 0;
-   numBytes = 0;
-
-   epicsUInt8 meta [80];
-   epicsUInt32 version;
-
-   numBytes = readWrapper (prec, &meta, stxLen);
-   total += numBytes;
-
-   DETAIL ("read meta data\n");
-
-   if (memcmp(&meta, asubExecStx, stxLen) != 0) {
-      ERROR ("read stx invalid\n");
-      return -1;
-   }
+   STANDARD_CHECK ();
 
-   numBytes = readWrapper (prec, &version, sizeof(version));
-   total += numBytes;
+   asubExecChild* standby = &pExecInfo->standby;
+   if (standby->pid <= 0) return;
 
-   /* Check version - skip minor version number \
-    */
-   if ((version & 0x00FFFF00) != (asubExecVersion & 0x00FFFF00)) {
-      ERROR ("version mis match, read %06X, expecting %06X\n",
-              version, asubExecVersion);
-      return -1;
+   if (asubExecChildDrain (standby) == 0) {
+      const double waited = (double) (asubExecTraceNow () - pExecInfo->standbyTime) * 1.0e-9;
+      if (standby->fdget < 0) {
+         abandonStandby (prec, "exited");
+      } else if (waited > pExecInfo->timeOut) {
+         abandonStandby (prec, "not ready");
+      }
+      return;
    }
 
+   const asubExecChild previous = pExecInfo->child;
+   const epicsUInt32 requests = pExecInfo->age.requests;
 
-   for (j = 0; j < NUMBER_IO_FIELDS; j++) {
-      static epicsUInt8 discard[512 * 1024];    /* TODO: use lseek instead ? */
+   pExecInfo->retiring = previous;
+   pExecInfo->retiringTime = asubExecTraceNow ();
+   asubExecChildClose (&pExecInfo->retiring);
+   asubExecPerfClose (&pExecInfo->perf);
 
-      const char key = (char) ((int) 'A' + j);  /* for diagnostic outputs */
+   pExecInfo->child = *standby;
+   pExecInfo->perf = pExecInfo->standbyPerf;
+   memset (&pExecInfo->age, 0, sizeof (pExecInfo->age));
+   pExecInfo->recycleDue = false;
+   standby->pid = -1;
 
-      const epicsEnum16 outputType = (&prec->ftva)[j];
-      const epicsUInt32 outputNumber = (&prec->nova)[j];
-      void *data = (&prec->vala)[j];
+   asubExecStatsRecycle (pExecInfo->stats);
 
-      epicsInt16 readExtType;
-      epicsEnum16 readIntType;
-      epicsUInt32 readNumber;
+   INFO ("worker (pid=%d) replaced by pid=%d after %u requests\n", previous.pid,
+         pExecInfo->child.pid, requests);
+}
 
-      numBytes = readWrapper (prec, &readExtType, sizeof (readExtType));
-      if (numBytes <= 0)
-         break;
-      total += numBytes;
-
-      /* Map standard to EPICS version specific type
-        */
-       readIntType = asubExecDataType2menuFtype (readExtType);
-       if (readIntType < 0 || readIntType >= menuFtype_NUM_CHOICES) {
-         ERROR ("read FTV%c type is invalid\n", key);
-         numBytes = -1;
-         break;
-      }
+/*------------------------------------------------------------------------------
+ * EXECLINK program selection.
+ * Sets the current program, parking the current persistent worker (if any) in
+ * its program's entry and taking that of the new program. An index of -1 just
+ * parks the current worker.
+ */
+static void switchProgram (dbCommon* prec, const int index)
+{
+   STANDARD_CHECK ();
 
-      numBytes = readWrapper (prec, &readNumber, sizeof (readNumber));
-      if (numBytes <= 0)
-         break;
-      total += numBytes;
-
-      const long elementSize = dbValueSize (readIntType);
-
-      if (readIntType == outputType) {
-         /* We have a winner - types match, so element sizes match
-          */
-         epicsUInt32 less = readNumber <= outputNumber ? readNumber : outputNumber;
-         epicsUInt32 skip = readNumber - less;
-
-         numBytes = readWrapper (prec, data, less * elementSize);
-         if (numBytes <= 0)
-            break;
-         total += numBytes;
-
-         if (skip > 0) {
-            numBytes = readWrapper (prec, discard, skip * elementSize);
-            if (numBytes < 0)
-               break;
-            total += numBytes;
-         }
+   const int current = pExecInfo->program;
 
-         if (readNumber != outputNumber) {
-            WARN ("NOV%c size mis-match expected: %d, actual: %d\n",
-                  key, outputNumber, readNumber);
-         }
+   if (pExecInfo->persistent) {
+      /* The standby, if any, is for the current program.
+       */
+      abandonStandby (prec, "program changed");
 
-      } else {
-         /* type mis match - eventually we may caste, but for now just discard
-          */
-         ERROR ("FTV%c mis-match expected: %d, actual %d\n",
-                key, outputType, readIntType);
-         epicsUInt32 skip = readNumber;
-         numBytes = readWrapper (prec, discard, skip * elementSize);
-         if (numBytes < 0)
-            break;
-         total += numBytes;
+      if (current >= 0) {
+         pExecInfo->programs [current].child = pExecInfo->child;
+         pExecInfo->programs [current].perf = pExecInfo->perf;
+         pExecInfo->programs [current].age = pExecInfo->age;
       }
-   }
-
-   if (numBytes >= 0) {
-      numBytes = readWrapper (prec, &meta, etxLen);
-      total += numBytes;
 
-      if (memcmp(meta, asubExecEtx, etxLen) != 0) {
-         ERROR ("read etx invalid\n");
-         return -1;
+      if (index >= 0) {
+         pExecInfo->child = pExecInfo->programs [index].child;
+         pExecInfo->perf = pExecInfo->programs [index].perf;
+         pExecInfo->age = pExecInfo->programs [index].age;
+      } else {
+         pExecInfo->child.pid = -1;
+         pExecInfo->child.fdput = -1;
+         pExecInfo->child.fdget = -1;
+         asubExecPerfInit (&pExecInfo->perf);
+         memset (&pExecInfo->age, 0, sizeof (pExecInfo->age));
       }
    }
 
-   return total;
+   pExecInfo->program = index;
 }
 
-
 /*------------------------------------------------------------------------------
- * executeProcess does all the hard work - it runs asynchronously in the
- * aSub record's associated thread.
+ * Stops the program's parked worker, if any, and frees its entry.
  */
-static bool executeProcess (aSubRecord* prec)
+static void retireProgram (dbCommon* prec, ExecProgram* program)
 {
-   STANDARD_CHECK (false);
+   asubExecChild* child = &program->child;
 
-   bool result = startChildProcess (prec);
-   if (!result) return result;
+   if (child->pid > 0) {
+      asubExecChildClose (child);
+      asubExecChildReap (child, 0.1, 2.1, &iocIsRunning);
+      INFO ("%s worker (pid=%d) evicted, exit code: %d\n", program->path, child->pid,
+            child->exitCode);
+   }
 
-   ssize_t total;
-   int status;
+   child->pid = -1;
+   child->fdput = -1;
+   child->fdget = -1;
+   asubExecPerfClose (&program->perf);
+   program->inUse = false;
+}
 
-   /* First encode/buffer up all the input and send to the child process.
-    * We write all the output data before reading any input data.
-    * The rules of the game are that the nonminated program/script should
-    * consume all its input before processing and generating any significant
-    * amount of output.  The pipes provide some leeway here.
+/*------------------------------------------------------------------------------
+ * Returns true if and only if the EXECLINK program name is in the EXECALLOW
+ * list. The name must match a listed name exactly, so a name containing a '/'
+ * is only allowed if that path name is listed.
+ */
+static bool programAllowed (const char* allow, const char* name)
+{
+   const size_t length = strlen (name);
+
+   if (!allow) return false;
+
+   while (*allow) {
+      size_t span;
+
+      allow += strspn (allow, " \t");
+      span = strcspn (allow, " \t");
+      if (span > 0 && span == length && strncmp (allow, name, length) == 0) {
+         return true;
+      }
+      allow += span;
+   }
+   return false;
+}
+
+/*------------------------------------------------------------------------------
+ * Selects the program to run from the EXECLINK input, if any, resolving it on
+ * first use. An empty input selects the EXEC program, any other must be allowed
+ * by EXECALLOW.
+ * Returns true if and only if successfull.
+ */
+static bool selectProgram (dbCommon* prec, const asubExecField inputs[])
+{
+   STANDARD_CHECK (false);
+
+   ExecProgram* programs = pExecInfo->programs;
+   char name [asubExecStringSize];
+   int j;
+   int k = -1;
+   int victim = 0;
+
+   if (pExecInfo->execLink < 0) return true;
+
+   const asubExecField* input = &inputs [pExecInfo->execLink];
+   name[0] = '\0';
+   if (input->number > 0) {
+      snprintf (name, sizeof (name), "%.*s", (int) sizeof (name) - 1,
+                (const char*) input->data);
+   }
+
+   /* Look for the program, noting the first free else least recently used
+    * entry in case it is not found.
     */
-   total = encodeAndWriteInputs (prec);
+   for (j = 0; j < EXEC_CACHE_SIZE; j++) {
+      if (programs[j].inUse && strcmp (programs[j].name, name) == 0) {
+         k = j;
+         break;
+      }
+      if (!programs[victim].inUse) continue;
+      if (!programs[j].inUse || programs[j].lastUsed < programs[victim].lastUsed) {
+         victim = j;
+      }
+   }
 
-   status = close (pExecInfo->fdput);
-   if (status != 0) {
-      PERRORF ("close  (input_data [out])");
+   if (k >= 0) {
+      asubExecStatsExecCache (pExecInfo->stats, true);
+      if (k != pExecInfo->program) switchProgram (prec, k);
+   } else {
+      const char* file = name[0] ? name : pExecInfo->execDefault;
+      char path [EXEC_PATH_SIZE];
+
+      if (name[0] && !programAllowed (pExecInfo->execAllow, name)) {
+         ERROR ("EXECLINK program '%s' not allowed by EXECALLOW\n", name);
+         return false;
+      }
+
+      if (!asubExecResolve (file, path, sizeof (path))) {
+         ERROR ("EXECLINK program '%s' not found\n", file);
+         return false;
+      }
+
+      switchProgram (prec, -1);
+      retireProgram (prec, &programs [victim]);
+
+      k = victim;
+      snprintf (programs[k].name, sizeof (programs[k].name), "%s", name);
+      snprintf (programs[k].path, sizeof (programs[k].path), "%s", path);
+      programs[k].inUse = true;
+
+      asubExecStatsExecCache (pExecInfo->stats, false);
+      switchProgram (prec, k);
+
+      INFO ("EXECLINK program '%s' resolved to %s\n", file, path);
+   }
+
+   programs[k].lastUsed = ++pExecInfo->programClock;
+   pExecInfo->argv[0] = programs[k].path;
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ * Sends this execution's request to the persistent worker, starting it if
+ * needs be, and reads the response. The worker is stopped (and so restarted
+ * by the next execution) on any error other than a failure response.
+ */
+static asubExecStatus executeWorker (dbCommon* prec)
+{
+   STANDARD_CHECK (asubExecIoError);
+
+   asubExecChild* child = &pExecInfo->child;
+   asubExecDeadline deadline;
+   asubExecStatus status;
+   epicsUInt32 tag = 0;
+
+   promoteStandby (prec);
+   if (child->pid <= 0 && !startWorker (prec)) return asubExecIoError;
+
+   pExecInfo->trace.pid = child->pid;
+   pExecInfo->trace.time [asubExecPhaseSpawned] = asubExecTraceNow ();
+
+   asubExecDeadlineSet (&deadline, pExecInfo->timeOut);
+
+   /* Only this request's counts - not the worker's start up or earlier requests.
+    */
+   if (pExecInfo->perfEnabled) asubExecPerfRead (&pExecInfo->perf, pExecInfo->perfBase);
+
+   ASUB_EXEC_PROBE2 (write_start, prec->name, child->pid);
+
+   pExecInfo->requestTag++;
+   status = asubExecChildSend (child, pExecInfo->requestTag,
+                               pExecInfo->input.data, pExecInfo->input.size,
+                               &deadline, &iocIsRunning);
+
+   pExecInfo->trace.time [asubExecPhaseWritten] = asubExecTraceNow ();
+   pExecInfo->trace.bytesIn = (status == asubExecOkay) ? pExecInfo->input.size : 0;
+
+   ASUB_EXEC_PROBE3 (write_end, prec->name, child->pid, (long) pExecInfo->trace.bytesIn);
+
+   if (status == asubExecOkay) {
+      ASUB_EXEC_PROBE2 (read_start, prec->name, child->pid);
+
+      status = asubExecChildReceive (child, &tag, &pExecInfo->output,
+                                     pExecInfo->numberOutputs, &deadline, &iocIsRunning);
+
+      ASUB_EXEC_PROBE3 (read_end, prec->name, child->pid, (long) pExecInfo->output.size);
+   }
+
+   pExecInfo->trace.time [asubExecPhaseRead] = asubExecTraceNow ();
+   pExecInfo->trace.bytesOut = pExecInfo->output.size;
+
+   if (status == asubExecOkay && tag != pExecInfo->requestTag) {
+      ERROR ("response tag %u, expected %u\n", tag, pExecInfo->requestTag);
+      status = asubExecIoError;
+   }
+
+   /* The exit code is 0 for success and 1 for a failure response, else that of
+    * the stopped worker.
+    */
+   if (status == asubExecOkay || status == asubExecFailed) {
+      child->exitCode = (status == asubExecOkay) ? 0 : 1;
+      accumulatePerf (prec);
+      ageWorker (prec, (double) (pExecInfo->trace.time [asubExecPhaseRead] -
+                                 pExecInfo->trace.time [asubExecPhaseSpawned]) * 1.0e-9);
+   } else {
+      stopWorker (prec);
+      if (status == asubExecTimedOut) child->exitCode = asubExecExitTimeout;
+   }
+
+   pExecInfo->trace.time [asubExecPhaseReaped] = asubExecTraceNow ();
+
+   ASUB_EXEC_PROBE3 (reap, prec->name, pExecInfo->trace.pid, child->exitCode);
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ * Reaps any detached children that have exited, and terminates those running
+ * beyond the timeout. Their output, if any, is discarded.
+ */
+static void pollDetached (dbCommon* prec)
+{
+   STANDARD_CHECK ();
+
+   int j;
+
+   for (j = 0; j < pExecInfo->detachedMax && pExecInfo->detachedCount > 0; j++) {
+      DetachedChild* slot = &pExecInfo->detachedChildren[j];
+      asubExecChild* child = &slot->child;
+
+      if (child->pid <= 0) continue;
+
+      const size_t discarded = asubExecChildDrain (child);
+      if (discarded > 0) {
+         DETAIL ("detached (pid=%d) output discarded: %d bytes\n", child->pid, (int) discarded);
+      }
+
+      if (!asubExecChildPoll (child)) {
+         if (asubExecDeadlineRemaining (&slot->deadline) > 0.0) continue;
+
+         WARN ("detached (pid=%d) timed out\n", child->pid);
+         asubExecChildReap (child, 0.0, 2.0, &iocIsRunning);
+         child->exitCode = asubExecExitTimeout;
+      }
+
+      asubExecChildClose (child);
+
+      if (child->exitCode != 0) {
+         WARN ("detached (pid=%d) exit code: %d\n", child->pid, child->exitCode);
+         asubExecStatsDetachedFailure (pExecInfo->stats);
+      } else {
+         INFO ("detached (pid=%d) complete\n", child->pid);
+      }
+
+      child->pid = -1;
+      pExecInfo->detachedCount--;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * Detached - starts the child process and writes the input frame. The record
+ * completes as soon as this is done, the child process' exit being accounted
+ * by pollDetached. At most detachedMax children may be outstanding.
+ */
+static asubExecStatus executeDetached (dbCommon* prec)
+{
+   STANDARD_CHECK (asubExecIoError);
+
+   DetachedChild* slot = NULL;
+   asubExecStatus status;
+   int j;
+
+   pollDetached (prec);
+
+   for (j = 0; j < pExecInfo->detachedMax; j++) {
+      if (pExecInfo->detachedChildren[j].child.pid <= 0) {
+         slot = &pExecInfo->detachedChildren[j];
+         break;
+      }
+   }
+
+   pExecInfo->child.exitCode = asubExecExitSetup;
+
+   if (!slot) {
+      ERROR ("%d detached children outstanding, request rejected\n", pExecInfo->detachedMax);
+      asubExecStatsDetach (pExecInfo->stats, true);
+      return asubExecIoError;
+   }
+
+   asubExecChild* child = &slot->child;
+
+   ASUB_EXEC_PROBE1 (spawn_start, prec->name);
+
+   if (!asubExecChildStart (child, pExecInfo->backend, pExecInfo->argv)) {
+      child->pid = -1;
+      return asubExecIoError;
    }
 
-   INFO ("wrote %d bytes\n", (int) total);
+   pExecInfo->detachedCount++;
+   asubExecStatsDetach (pExecInfo->stats, false);
+
+   pExecInfo->trace.pid = child->pid;
+   pExecInfo->trace.time [asubExecPhaseSpawned] = asubExecTraceNow ();
+
+   ASUB_EXEC_PROBE2 (spawn_end, prec->name, child->pid);
+
+   INFO ("%s (pid=%d) detached\n", pExecInfo->argv[0], child->pid);
+
+   asubExecDeadlineSet (&slot->deadline, pExecInfo->timeOut);
+
+   ASUB_EXEC_PROBE2 (write_start, prec->name, child->pid);
+
+   status = asubExecChildWrite (child, pExecInfo->input.data, pExecInfo->input.size,
+                                &slot->deadline, &iocIsRunning);
+
+   const epicsUInt64 now = asubExecTraceNow ();
+   pExecInfo->trace.time [asubExecPhaseWritten] = now;
+   pExecInfo->trace.time [asubExecPhaseRead] = now;
+   pExecInfo->trace.time [asubExecPhaseReaped] = now;
+   pExecInfo->trace.bytesIn = (status == asubExecOkay) ? pExecInfo->input.size : 0;
 
-   /* Unpack the response
+   ASUB_EXEC_PROBE3 (write_end, prec->name, child->pid, (long) pExecInfo->trace.bytesIn);
+
+   /* The child is left to it - a failed write is the record's failure, the
+    * child process' exit is accounted when it is reaped.
     */
-   total = readAndDecodeOutputs (prec);
+   if (status == asubExecOkay) pExecInfo->child.exitCode = 0;
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ * Singleflight - either lead the execution, or wait for the response of an
+ * identical execution already in flight.
+ */
+static asubExecStatus executeShared (dbCommon* prec)
+{
+   STANDARD_CHECK (asubExecIoError);
 
-   /* We expect all reads to be good and to have read the minimum number of
-    * expected bytes.
+   asubExecSharedCall* call;
+   asubExecSharedWaiter waiter;
+   asubExecStatus status;
+   bool leader;
+
+   waiter.wake = pExecInfo->sharedEvent;
+   call = asubExecSharedJoin (pExecInfo->argv, &pExecInfo->input, &waiter, &leader);
+
+   if (leader) {
+      status = pExecInfo->persistent ? executeWorker (prec) : executeChild (prec);
+      pExecInfo->response = asubExecSharedComplete (call, &pExecInfo->output, status,
+                                                    pExecInfo->child.exitCode);
+      return status;
+   }
+
+   INFO ("sharing an execution in flight\n");
+
+   status = asubExecSharedWait (call, &waiter, pExecInfo->timeOut,
+                                &pExecInfo->response, &pExecInfo->child.exitCode);
+
+   const epicsUInt64 now = asubExecTraceNow ();
+   pExecInfo->trace.flags |= asubExecTraceShared;
+   pExecInfo->trace.time [asubExecPhaseRead] = now;
+   pExecInfo->trace.time [asubExecPhaseReaped] = now;
+   pExecInfo->trace.bytesOut = pExecInfo->response ? pExecInfo->response->size : 0;
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ * executeProcess does all the hard work - it runs asynchronously in the
+ * record's associated thread. A dry run, used to warm up, does not capture or
+ * decode the response.
+ */
+static bool executeProcess (dbCommon* prec, const bool dryRun)
+{
+   STANDARD_CHECK (false);
+
+   asubExecField inputs [asubExecMaxFields];
+   asubExecField outputs [asubExecMaxFields];
+   asubExecStatus status;
+
+   pExecInfo->output.size = 0;
+   asubExecBlobRelease (pExecInfo->response);
+   pExecInfo->response = NULL;
+   pExecInfo->capturing = !dryRun &&
+       asubExecCaptureSelected (prec->name, &pExecInfo->captureGeneration,
+                                &pExecInfo->captureSelected);
+
+   /* First encode/buffer up all the input, including info about the output
+    * fields (type and max elements).
     */
-   if (total <= NUMBER_IO_FIELDS * (sizeof (epicsInt16) + sizeof (epicsUInt32))) {
+   pExecInfo->binding->describe (prec, inputs, outputs);
+
+   if (!selectProgram (prec, inputs)) {
+      pExecInfo->input.size = 0;
+      return false;
+   }
+
+   status = asubExecEncodeWith (&pExecInfo->input, pExecInfo->binding->counted,
+                                inputs, pExecInfo->numberInputs,
+                                pExecInfo->inputTypes, pExecInfo->slices,
+                                outputs, pExecInfo->numberOutputs);
+   if (status != asubExecOkay) {
+      ERROR ("unable to encode inputs: %s\n", asubExecStatusText (status));
+      pExecInfo->input.size = 0;
+      return false;
+   }
+
+   if (pExecInfo->detached) {
+      status = executeDetached (prec);
+   } else if (pExecInfo->singleflight) {
+      status = executeShared (prec);
+   } else if (pExecInfo->persistent) {
+      status = executeWorker (prec);
+   } else {
+      status = executeChild (prec);
+   }
+
+   if (status != asubExecOkay) {
       /* Unexpected end of input, timeout or IOC terminate or insuffient data
        */
-      PERRORF ("failure");
-      result = false;
+      ERROR ("read response %s\n", asubExecStatusText (status));
+      return false;
    }
 
-   status = close (pExecInfo->fdget);
-   if (status != 0) {
-      PERRORF ("close  (output_data [in])");
+   if (dryRun || pExecInfo->detached) return true;
+
+   return decodeOutputs (prec, outputs);
+}
+
+/*------------------------------------------------------------------------------
+ * Comparison function for qsort.
+ */
+static int compareDouble (const void* a, const void* b)
+{
+   const double x = *(const double*) a;
+   const double y = *(const double*) b;
+   return (x > y) - (x < y);
+}
+
+/*------------------------------------------------------------------------------
+ * Determine the latency alarm severity, if any, for this execution.
+ * Returns NO_ALARM, MINOR_ALARM or MAJOR_ALARM.
+ */
+static epicsEnum16 checkLatency (dbCommon* prec, const double latency)
+{
+   STANDARD_CHECK (NO_ALARM);
+
+   if (pExecInfo->latencyMinor <= 0.0 && pExecInfo->latencyMajor <= 0.0) return NO_ALARM;
+
+   double value = latency;
+
+   if (pExecInfo->latencyBasis == LATENCY_P95) {
+      double sorted [LATENCY_WINDOW];
+      int n;
+
+      pExecInfo->latencyWindow [pExecInfo->latencyCount % LATENCY_WINDOW] = latency;
+      pExecInfo->latencyCount++;
+
+      n = pExecInfo->latencyCount < LATENCY_WINDOW ? pExecInfo->latencyCount : LATENCY_WINDOW;
+      memcpy (sorted, pExecInfo->latencyWindow, n * sizeof (double));
+      qsort (sorted, n, sizeof (double), compareDouble);
+      value = sorted [(95 * (n - 1)) / 100];
+   }
+
+   if (pExecInfo->latencyMajor > 0.0 && value > pExecInfo->latencyMajor) {
+      WARN ("latency %.3fs exceeds major threshold %.3fs\n", value, pExecInfo->latencyMajor);
+      return MAJOR_ALARM;
+   }
+
+   if (pExecInfo->latencyMinor > 0.0 && value > pExecInfo->latencyMinor) {
+      INFO ("latency %.3fs exceeds minor threshold %.3fs\n", value, pExecInfo->latencyMinor);
+      return MINOR_ALARM;
+   }
+
+   return NO_ALARM;
+}
+
+/*------------------------------------------------------------------------------
+ * Completes the execution trace and passes it on to the flight recorder
+ * and the performance statistics.
+ */
+static void traceComplete (dbCommon* prec, const bool okay)
+{
+   STANDARD_CHECK ();
+
+   asubExecTrace* trace = &pExecInfo->trace;
+
+   trace->exitCode = pExecInfo->child.exitCode;
+   if (!okay) trace->flags |= asubExecTraceFailed;
+   if (pExecInfo->child.exitCode == asubExecExitTimeout) trace->flags |= asubExecTraceTimeout;
+   if (!iocIsRunning) trace->flags |= asubExecTraceShutdown;
+
+   /* The end to end latency - the record completion is imminent.
+    */
+   const epicsUInt64 end = trace->time [asubExecPhaseReaped] ?
+       trace->time [asubExecPhaseReaped] : asubExecTraceNow ();
+   const double latency = (double) (end - trace->time [asubExecPhaseQueued]) * 1.0e-9;
+
+   pExecInfo->latencySevr = checkLatency (prec, latency);
+   if (pExecInfo->latencySevr == MAJOR_ALARM) trace->flags |= asubExecTraceLatencyMajor;
+   if (pExecInfo->latencySevr == MINOR_ALARM) trace->flags |= asubExecTraceLatencyMinor;
+
+   asubExecFlightRecord (prec->name, trace);
+   asubExecStatsUpdate (pExecInfo->stats, trace);
+
+   if (pExecInfo->capturing) {
+      const asubExecBlob* response = pExecInfo->response;
+      asubExecCaptureWrite (prec->name, trace,
+                            pExecInfo->input.data, pExecInfo->input.size,
+                            response ? response->data : pExecInfo->output.data,
+                            response ? response->size : pExecInfo->output.size);
+      pExecInfo->capturing = false;
+   }
+
+   /* Done with any shared response.
+    */
+   asubExecBlobRelease (pExecInfo->response);
+   pExecInfo->response = NULL;
+
+   ASUB_EXEC_PROBE5 (complete, prec->name, trace->pid, trace->exitCode, trace->flags,
+                     (long long) (end - trace->time [asubExecPhaseQueued]));
+}
+
+/*------------------------------------------------------------------------------
+ * Warm up - runs in the record's thread, the record's pact having been set by
+ * warmupRequest, so that the record is not processed meanwhile.
+ */
+static void warmup (dbCommon* prec)
+{
+   STANDARD_CHECK ();
+
+   pExecInfo->warmupRequested = false;
+
+   if (pExecInfo->warmup == WARMUP_DRY) {
+      const bool okay = executeProcess (prec, true);
+      INFO ("warm up dry run %s\n", okay ? "complete" : "failed");
+   } else {
+      asubExecField inputs [asubExecMaxFields];
+      asubExecField outputs [asubExecMaxFields];
+
+      pExecInfo->binding->describe (prec, inputs, outputs);
+      if (selectProgram (prec, inputs) && pExecInfo->child.pid <= 0) {
+         startWorker (prec);
+      }
    }
 
-   INFO ("read %d bytes\n", (int) total);
-   INFO ("%s (pid=%d) complete\n", pExecInfo->argv[0], pExecInfo->pid);
+   dbScanLock (prec);
+   prec->pact = FALSE;
+   dbScanUnlock (prec);
+}
+
+/*------------------------------------------------------------------------------
+ * Callback function - hands the warm up to the record's thread, unless busy.
+ */
+static void warmupRequest (epicsCallback* pcallback)
+{
+   dbCommon* prec;
+   callbackGetUser (prec, pcallback);
+   STANDARD_CHECK ();
+
+   dbScanLock (prec);
+   if (prec->pact) {
+      INFO ("busy - warm up skipped\n");
+   } else {
+      prec->pact = TRUE;
+      pExecInfo->warmupRequested = true;
+      epicsEventSignal (pExecInfo->event);
+   }
+   dbScanUnlock (prec);
+}
 
-   waitChildProcess (prec, false);
+/*------------------------------------------------------------------------------
+ * Init hook function - schedules the warm ups once the IOC is running.
+ */
+static void warmupHook (initHookState state)
+{
+   if (state != initHookAfterIocRunning) return;
 
-   INFO ("process exit code: %d\n", pExecInfo->exitCode);
+   const double spacing = asubExecWarmupSpacing > 0.0 ? asubExecWarmupSpacing : 0.0;
+   ExecInfo* pExecInfo = (ExecInfo*) ellFirst (&warmupList);
+   int k = 0;
 
-   return result;
+   while (pExecInfo) {
+      callbackRequestDelayed (&pExecInfo->warmupCallback, k * spacing);
+      k++;
+      pExecInfo = (ExecInfo*) ellNext (&pExecInfo->node);
+   }
 }
 
 /*------------------------------------------------------------------------------
@@ -992,7 +1591,7 @@ static bool executeProcess (aSubRecord* prec)
  * This thread the function essentially waits for the child process to terminate
  * and then calls the records process function to deal with the response.
  */
-static void executeThread (aSubRecord* prec)
+static void executeThread (dbCommon* prec)
 {
    STANDARD_CHECK ();
 
@@ -1010,18 +1609,68 @@ static void executeThread (aSubRecord* prec)
 
       INFO ("executeThread sleeping  ...\n");
 
-      epicsEventWait (pExecInfo->event);
+      /* Poll any outstanding detached children whilst waiting.
+       */
+      while (pExecInfo->detachedCount > 0 && iocIsRunning &&
+             epicsEventWaitWithTimeout (pExecInfo->event, DETACHED_POLL) ==
+             epicsEventWaitTimeout) {
+         pollDetached (prec);
+      }
+      if (pExecInfo->detachedCount == 0) epicsEventWait (pExecInfo->event);
       if (!iocIsRunning) break;
 
-      INFO ("executeThread awake ...\n", now(), prec->name);
+      INFO ("executeThread awake ...\n");
+
+      if (pExecInfo->warmupRequested) {
+         warmup (prec);
+         continue;
+      }
 
-      bool status = executeProcess (prec);
+      pExecInfo->trace.time [asubExecPhaseStart] = asubExecTraceNow ();
+      asubExecStatsActive (true);
+
+      bool status = executeProcess (prec, false);
       pExecInfo->status = status ? 0 : -1;
 
+      traceComplete (prec, status);
+      asubExecStatsActive (false);
+
+      if (pExecInfo->binding->complete) {
+         pExecInfo->binding->complete (prec, pExecInfo->child.exitCode);
+      }
+
       /* One way or another, the child process is (deemed) complete.
        * Initiate processing part 2
        */
-      rset->process ((dbCommon *) prec);
+      rset->process (prec);
+
+      /* Worker house keeping, once the record has completed.
+       */
+      if (pExecInfo->persistent) {
+         if (pExecInfo->recycleDue) recycleWorker (prec);
+         promoteStandby (prec);
+         reapRetired (prec);
+      }
+   }
+
+   /* Detached children are left to run, but not via our pipes.
+    */
+   {
+      int j;
+      for (j = 0; j < pExecInfo->detachedMax; j++) {
+         asubExecChildClose (&pExecInfo->detachedChildren[j].child);
+      }
+   }
+
+   /* The workers exit when their stdin is closed.
+    */
+   if (pExecInfo->persistent) {
+      asubExecChildClose (&pExecInfo->child);
+      asubExecChildClose (&pExecInfo->standby);
+      int j;
+      for (j = 0; j < EXEC_CACHE_SIZE; j++) {
+         asubExecChildClose (&pExecInfo->programs[j].child);
+      }
    }
 
    INFO ("executeThread terminated\n");
@@ -1029,11 +1678,266 @@ static void executeThread (aSubRecord* prec)
 
 
 /*------------------------------------------------------------------------------
- * Record functions
- *------------------------------------------------------------------------------
+ * Token bucket - returns 0.0 if a token was taken, otherwise the time in seconds
+ * until the next token is available.
+ * Only called from record processing, i.e. with the record locked.
  */
-static long asubExecInit (aSubRecord* prec)
+static double takeToken (ExecInfo* pExecInfo)
+{
+   const epicsUInt64 now = asubExecTraceNow ();
+   const double elapsed = (double) (now - pExecInfo->tokenTime) * 1.0e-9;
+
+   pExecInfo->tokenTime = now;
+   pExecInfo->tokens += elapsed * pExecInfo->maxRate;
+   if (pExecInfo->tokens > pExecInfo->maxBurst) pExecInfo->tokens = pExecInfo->maxBurst;
+
+   if (pExecInfo->tokens >= 1.0) {
+      pExecInfo->tokens -= 1.0;
+      return 0.0;
+   }
+
+   return (1.0 - pExecInfo->tokens) / pExecInfo->maxRate;
+}
+
+/*------------------------------------------------------------------------------
+ * Starts an execution, the record's pact having been set - wakes up the thread,
+ * now or after the given delay (seconds).
+ */
+static void startRequest (dbCommon* prec, const double delay)
+{
+   STANDARD_CHECK ();
+
+   /* Start a new trace - the thread is idle so this is safe.
+    */
+   memset (&pExecInfo->trace, 0, sizeof (pExecInfo->trace));
+   pExecInfo->trace.pid = -1;
+   pExecInfo->trace.time [asubExecPhaseQueued] = asubExecTraceNow ();
+
+   ASUB_EXEC_PROBE1 (queue, prec->name);
+
+   if (delay > 0.0) {
+      callbackRequestDelayed (&pExecInfo->staggerCallback, delay);
+   } else {
+      epicsEventSignal (pExecInfo->event);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * Callback function - re-processes the record once a token is due, so that the
+ * execution uses the inputs current at that time.
+ */
+static void deferredStart (epicsCallback* pcallback)
+{
+   dbCommon* prec;
+   callbackGetUser (prec, pcallback);
+   STANDARD_CHECK ();
+
+   dbScanLock (prec);
+   if (pExecInfo->deferHeld) {
+      pExecInfo->deferHeld = false;
+      prec->pact = FALSE;
+   }
+   pExecInfo->deferPending = false;
+   dbProcess (prec);
+   dbScanUnlock (prec);
+}
+
+/*------------------------------------------------------------------------------
+ * Callback function - ends the hold on a deferred request. Any RPRO set while
+ * held is covered by the pending re-process.
+ */
+static void deferredRelease (epicsCallback* pcallback)
+{
+   dbCommon* prec;
+   callbackGetUser (prec, pcallback);
+   STANDARD_CHECK ();
+
+   dbScanLock (prec);
+   if (pExecInfo->deferHeld) {
+      pExecInfo->deferHeld = false;
+      prec->rpro = FALSE;
+      prec->pact = FALSE;
+   }
+   dbScanUnlock (prec);
+}
+
+/*------------------------------------------------------------------------------
+ * Defers the request: schedules a single re-process for when the next token is
+ * due, coalescing any further requests made in the meantime. The record is held
+ * active only until the record support returns, so that monitors and the
+ * forward link are not processed, and further requests (e.g. CP updates) are
+ * accepted rather than dropped.
+ */
+static void deferRequest (dbCommon* prec, ExecInfo* pExecInfo, const double delay)
+{
+   asubExecStatsDefer (pExecInfo->stats);
+
+   if (!pExecInfo->deferPending) {
+      pExecInfo->deferPending = true;
+      callbackRequestDelayed (&pExecInfo->deferCallback, delay);
+      DETAIL ("deferred %.3fs\n", delay);
+   }
+
+   if (callbackRequest (&pExecInfo->releaseCallback) == 0) {
+      pExecInfo->deferHeld = true;
+      prec->pact = TRUE;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * Releases the record's balanced placement, if any, freeing the period's table
+ * once no records are placed in it.
+ */
+static void staggerRelease (ExecInfo* pExecInfo)
+{
+   StaggerTable* table = pExecInfo->staggerTable;
+   bool empty = true;
+   int j;
+
+   if (!table) return;
+
+   epicsMutexMustLock (staggerLock);
+
+   table->count[pExecInfo->staggerSlot]--;
+   for (j = 0; j < STAGGER_SLOTS; j++) {
+      if (table->count[j] > 0) empty = false;
+   }
+   if (empty) table->period = 0.0;
+
+   epicsMutexUnlock (staggerLock);
+
+   pExecInfo->staggerTable = NULL;
+   pExecInfo->staggerPeriod = 0.0;
+}
+
+/*------------------------------------------------------------------------------
+ * Places the record in the least used slot of the period, releasing any earlier
+ * placement first. Returns the slot's phase as a fraction, or a negative value
+ * if there are too many periods.
+ */
+static double staggerPlace (ExecInfo* pExecInfo, const double period)
+{
+   StaggerTable* table = NULL;
+   int j;
+   int slot = 0;
+
+   staggerRelease (pExecInfo);
+
+   epicsMutexMustLock (staggerLock);
+
+   for (j = 0; j < STAGGER_PERIODS && !table; j++) {
+      if (staggerTables[j].period == period) table = &staggerTables[j];
+   }
+   for (j = 0; j < STAGGER_PERIODS && !table; j++) {
+      if (staggerTables[j].period == 0.0) {
+         table = &staggerTables[j];
+         table->period = period;
+      }
+   }
+
+   if (table) {
+      for (j = 1; j < STAGGER_SLOTS; j++) {
+         if (table->count[j] < table->count[slot]) slot = j;
+      }
+      table->count[slot]++;
+   }
+
+   epicsMutexUnlock (staggerLock);
+
+   pExecInfo->staggerTable = table;
+   pExecInfo->staggerSlot = slot;
+
+   return table ? (double) slot / (double) STAGGER_SLOTS : -1.0;
+}
+
+/*------------------------------------------------------------------------------
+ * FNV-1a hash of the record name, as a fraction in [0, 1).
+ */
+static double staggerHash (const char* name)
+{
+   epicsUInt32 hash = 2166136261u;
+   const char* p;
+
+   for (p = name; *p; p++) {
+      hash ^= (epicsUInt8) *p;
+      hash *= 16777619u;
+   }
+   return (double) hash / 4294967296.0;
+}
+
+/*------------------------------------------------------------------------------
+ * The delay (seconds) before starting this execution, if periodically scanned,
+ * so that records on the same scan period do not all execute together.
+ * Only called from record processing, i.e. with the record locked.
+ */
+static double staggerDelay (dbCommon* prec)
+{
+   STANDARD_CHECK (0.0);
+
+   if (pExecInfo->stagger == STAGGER_NONE) return 0.0;
+
+   const double period = prec->scan < SCAN_1ST_PERIODIC ? 0.0 : scanPeriod (prec->scan);
+   if (period <= 0.0) {
+      staggerRelease (pExecInfo);   /* no longer periodic */
+      return 0.0;
+   }
+
+   /* Balanced placement is done when first scanned on the period, as the
+    * scan periods are only known once the scan tasks exist.
+    */
+   if (pExecInfo->stagger == STAGGER_BALANCED && pExecInfo->staggerPeriod != period) {
+      const double fraction = staggerPlace (pExecInfo, period);
+      pExecInfo->staggerFraction = fraction >= 0.0 ? fraction : staggerHash (prec->name);
+      pExecInfo->staggerPeriod = period;
+      INFO ("staggered by %.3fs of %.3fs\n",
+            pExecInfo->staggerFraction * pExecInfo->staggerSpan * period, period);
+   }
+
+   return pExecInfo->staggerFraction * pExecInfo->staggerSpan * period;
+}
+
+/*------------------------------------------------------------------------------
+ * Callback function - starts a staggered execution. The deliberate delay is
+ * not counted as latency or queue wait.
+ */
+static void staggerStart (epicsCallback* pcallback)
+{
+   dbCommon* prec;
+   callbackGetUser (prec, pcallback);
+   STANDARD_CHECK ();
+
+   pExecInfo->trace.time [asubExecPhaseQueued] = asubExecTraceNow ();
+   epicsEventSignal (pExecInfo->event);
+}
+
+/*------------------------------------------------------------------------------
+ * Extract a double info value, if it has been specified.
+ * Returns true if found and valid, in which case value is updated.
+ */
+static bool getInfoDouble (dbCommon* prec, DBENTRY* pEntry, const char* name,
+                           double* value)
+{
+   long status = dbFindInfo (pEntry, name);
+   if ((status != 0) || !pEntry->pinfonode) return false;
+
+   char *endptr;
+   const double t = epicsStrtod (pEntry->pinfonode->string, &endptr);
+   if (endptr == pEntry->pinfonode->string) {
+      WARN ("Invalid %s value '%s', ignored\n", name, pEntry->pinfonode->string);
+      return false;
+   }
+
+   *value = t;
+   INFO ("%s %g\n", name, t);
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+long asubExecAttach (dbCommon* prec, const asubExecBinding* binding)
 {
+   asubExecField inputs [asubExecMaxFields];
+   asubExecField outputs [asubExecMaxFields];
    int j;
    long status;
    ExecInfo* pExecInfo;
@@ -1049,10 +1953,12 @@ static long asubExecInit (aSubRecord* prec)
 
    /* Allocate and save memory for this record's private data.
     */
-   pExecInfo = (ExecInfo *) callocMustSucceed (1, sizeof (ExecInfo), "asubExecInit");
+   pExecInfo = (ExecInfo *) callocMustSucceed (1, sizeof (ExecInfo), "asubExecAttach");
    prec->dpvt = pExecInfo;
 
    pExecInfo->prec = prec;
+   pExecInfo->binding = binding;
+   binding->count (prec, &pExecInfo->numberInputs, &pExecInfo->numberOutputs);
    pExecInfo->event = epicsEventCreate (epicsEventEmpty);
 
    for (j = 0; j < ARG_LENGTH; j++) {
@@ -1060,9 +1966,26 @@ static long asubExecInit (aSubRecord* prec)
    }
 
    pExecInfo->timeOut = 60.0;   /* default: one minute */
-   pExecInfo->pid = -1;
-   pExecInfo->fdput = -1;
-   pExecInfo->fdget = -1;
+   pExecInfo->child.pid = -1;
+   pExecInfo->child.fdput = -1;
+   pExecInfo->child.fdget = -1;
+   asubExecPerfInit (&pExecInfo->perf);
+   pExecInfo->retiring.pid = -1;
+   pExecInfo->retiring.fdput = -1;
+   pExecInfo->retiring.fdget = -1;
+   pExecInfo->standby.pid = -1;
+   pExecInfo->standby.fdput = -1;
+   pExecInfo->standby.fdget = -1;
+   asubExecPerfInit (&pExecInfo->standbyPerf);
+
+   pExecInfo->execLink = -1;
+   pExecInfo->program = -1;
+   for (j = 0; j < EXEC_CACHE_SIZE; j++) {
+      pExecInfo->programs[j].child.pid = -1;
+      pExecInfo->programs[j].child.fdput = -1;
+      pExecInfo->programs[j].child.fdget = -1;
+      asubExecPerfInit (&pExecInfo->programs[j].perf);
+   }
 
    /* Search for this record's INFO fields
     */
@@ -1084,6 +2007,9 @@ static long asubExecInit (aSubRecord* prec)
 
    dbInfoNode *infoNode = entry.pinfonode;
    pExecInfo->argv[0] = epicsStrDup (infoNode->string);
+   pExecInfo->execDefault = pExecInfo->argv[0];
+
+   pExecInfo->stats = asubExecStatsAttach (prec->name, infoNode->string);
 
    status = dbFindInfo (&entry, "ARG1");
    if ((status == 0) && entry.pinfonode) {
@@ -1123,6 +2049,346 @@ static long asubExecInit (aSubRecord* prec)
       INFO ("timeout %.2fs\n", pExecInfo->timeOut);
    }
 
+   /* Extract input types the child wants, if specified. Numeric inputs are
+    * converted before being sent.
+    */
+   binding->describe (prec, inputs, outputs);
+
+   for (j = 0; j < pExecInfo->numberInputs; j++) {
+      char key [4];
+      char infoName [12];
+
+      pExecInfo->inputTypes[j] = asubExecTypeNone;
+
+      binding->key (j, key, sizeof (key));
+      snprintf (infoName, sizeof (infoName), "INTYPE_%s", key);
+      status = dbFindInfo (&entry, infoName);
+      if ((status != 0) || !entry.pinfonode) continue;
+
+      const char* name = entry.pinfonode->string;
+      const asubExecDataType type = asubExecTypeFromName (name);
+      const asubExecDataType fieldType = inputs[j].type;
+
+      if (!asubExecTypeIsNumeric (type) || !asubExecTypeIsNumeric (fieldType)) {
+         WARN ("Invalid %s '%s' for %s%s %s, ignored\n", infoName, name,
+               binding->inputTypeName, key, asubExecTypeName (fieldType));
+         continue;
+      }
+
+      pExecInfo->inputTypes[j] = type;
+      INFO ("%s %s\n", infoName, name);
+   }
+
+   /* Extract the input link selecting the program at run time, if specified,
+    * e.g. info (EXECLINK, "INPU"). This must be a STRING input.
+    */
+   status = dbFindInfo (&entry, "EXECLINK");
+   if ((status == 0) && entry.pinfonode) {
+      const char* link = entry.pinfonode->string;
+
+      for (j = 0; j < pExecInfo->numberInputs; j++) {
+         char key [4];
+         char linkName [8];
+
+         binding->key (j, key, sizeof (key));
+         snprintf (linkName, sizeof (linkName), "%s%s", binding->inputLinkName, key);
+         if (strcmp (link, linkName) == 0) break;
+      }
+
+      if (j >= pExecInfo->numberInputs) {
+         WARN ("Invalid EXECLINK '%s', ignored\n", link);
+      } else if (inputs[j].type != asubExecTypeSTRING) {
+         WARN ("EXECLINK %s must be a STRING input, ignored\n", link);
+      } else {
+         pExecInfo->execLink = j;
+         INFO ("EXECLINK %s\n", link);
+      }
+   }
+
+   /* Extract the programs that EXECLINK may select, if specified, e.g.
+    * info (EXECALLOW, "progA progB"). Without this only EXEC may be selected.
+    */
+   if (pExecInfo->execLink >= 0) {
+      status = dbFindInfo (&entry, "EXECALLOW");
+      if ((status == 0) && entry.pinfonode) {
+         pExecInfo->execAllow = epicsStrDup (entry.pinfonode->string);
+         INFO ("EXECALLOW %s\n", pExecInfo->execAllow);
+      } else {
+         WARN ("EXECLINK without EXECALLOW, only %s may be selected\n",
+               pExecInfo->execDefault);
+      }
+   }
+
+   /* Extract input pre processing, if specified. Strings may only be sliced,
+    * not reduced.
+    */
+   for (j = 0; j < pExecInfo->numberInputs; j++) {
+      char key [4];
+      char infoName [12];
+      asubExecSlice slice;
+
+      pExecInfo->slices[j] = NULL;
+
+      binding->key (j, key, sizeof (key));
+      snprintf (infoName, sizeof (infoName), "ROI_%s", key);
+      status = dbFindInfo (&entry, infoName);
+      if ((status != 0) || !entry.pinfonode) continue;
+
+      const char* spec = entry.pinfonode->string;
+
+      if (!asubExecSliceParse (spec, &slice)) {
+         WARN ("Invalid %s '%s', ignored\n", infoName, spec);
+         continue;
+      }
+
+      if (!asubExecTypeIsNumeric (inputs[j].type) && slice.reduce != asubExecReducePick) {
+         WARN ("%s reduction not applicable to %s%s %s, ignored\n", infoName,
+               binding->inputTypeName, key, asubExecTypeName (inputs[j].type));
+         continue;
+      }
+
+      asubExecSlice* copy = callocMustSucceed (1, sizeof (slice), "asubExecAttach");
+      *copy = slice;
+      pExecInfo->slices[j] = copy;
+      INFO ("%s %s\n", infoName, spec);
+   }
+
+   /* Extract output post processing, if specified. This is only applicable
+    * to FLOAT and DOUBLE outputs.
+    */
+   for (j = 0; j < pExecInfo->numberOutputs; j++) {
+      char key [4];
+      char infoName [16];
+      asubExecTransform transform;
+
+      pExecInfo->transforms[j] = NULL;
+
+      binding->key (j, key, sizeof (key));
+      snprintf (infoName, sizeof (infoName), "POST_%s%s", binding->outputValueName, key);
+      status = dbFindInfo (&entry, infoName);
+      if ((status != 0) || !entry.pinfonode) continue;
+
+      const char* spec = entry.pinfonode->string;
+      const asubExecDataType fieldType = outputs[j].type;
+
+      if ((fieldType != asubExecTypeFLOAT) && (fieldType != asubExecTypeDOUBLE)) {
+         WARN ("%s not applicable to %s%s %s, ignored\n", infoName,
+               binding->outputTypeName, key, asubExecTypeName (fieldType));
+         continue;
+      }
+
+      if (!asubExecTransformParse (spec, &transform)) {
+         WARN ("Invalid %s '%s', ignored\n", infoName, spec);
+         continue;
+      }
+
+      asubExecTransform* copy = callocMustSucceed (1, sizeof (transform), "asubExecAttach");
+      *copy = transform;
+      pExecInfo->transforms[j] = copy;
+      INFO ("%s %s\n", infoName, spec);
+   }
+
+   /* Extract child process creation method if specified.
+    */
+   pExecInfo->backend = asubExecBackendFork;
+   status = dbFindInfo (&entry, "BACKEND");
+   if ((status == 0) && entry.pinfonode) {
+      const char* backend = entry.pinfonode->string;
+      if (strcmp (backend, "posix_spawn") == 0) {
+         pExecInfo->backend = asubExecBackendSpawn;
+      } else if (strcmp (backend, "fork") != 0) {
+         WARN ("Invalid BACKEND '%s', using 'fork'\n", backend);
+      }
+      INFO ("backend %s\n", backend);
+   }
+
+   /* Extract execution mode if specified.
+    */
+   status = dbFindInfo (&entry, "MODE");
+   if ((status == 0) && entry.pinfonode) {
+      const char* mode = entry.pinfonode->string;
+      if (strcmp (mode, "persistent") == 0) {
+         pExecInfo->persistent = true;
+      } else if (strcmp (mode, "detached") == 0) {
+         pExecInfo->detached = true;
+      } else if (strcmp (mode, "oneshot") != 0) {
+         WARN ("Invalid MODE '%s', using 'oneshot'\n", mode);
+      }
+      INFO ("mode %s\n", mode);
+   }
+
+   /* Extract the detached children limit if specified.
+    */
+   if (pExecInfo->detached) {
+      double limit = DETACHED_MAX;
+      if (getInfoDouble (prec, &entry, "DETACHED_MAX", &limit) && limit < 1.0) {
+         WARN ("DETACHED_MAX must be at least 1, using %d\n", DETACHED_MAX);
+         limit = DETACHED_MAX;
+      }
+
+      pExecInfo->detachedMax = (int) limit;
+      pExecInfo->detachedChildren = callocMustSucceed (pExecInfo->detachedMax,
+                                                       sizeof (DetachedChild),
+                                                       "asubExecAttach");
+      for (j = 0; j < pExecInfo->detachedMax; j++) {
+         pExecInfo->detachedChildren[j].child.pid = -1;
+         pExecInfo->detachedChildren[j].child.fdput = -1;
+         pExecInfo->detachedChildren[j].child.fdget = -1;
+      }
+   }
+
+   /* Extract persistent worker recycling policies if specified.
+    */
+   {
+      double requests = 0.0;
+      double rss = 0.0;
+
+      getInfoDouble (prec, &entry, "RECYCLE_REQUESTS", &requests);
+      getInfoDouble (prec, &entry, "RECYCLE_RSS", &rss);
+      getInfoDouble (prec, &entry, "RECYCLE_DRIFT", &pExecInfo->recycleDrift);
+
+      if (!pExecInfo->persistent && (requests > 0.0 || rss > 0.0 ||
+                                     pExecInfo->recycleDrift > 0.0)) {
+         WARN ("RECYCLE_ only applicable to persistent MODE, ignored\n");
+         requests = rss = pExecInfo->recycleDrift = 0.0;
+      }
+
+      if (pExecInfo->recycleDrift > 0.0 && pExecInfo->recycleDrift <= 1.0) {
+         WARN ("RECYCLE_DRIFT must be greater than 1, ignored\n");
+         pExecInfo->recycleDrift = 0.0;
+      }
+
+      pExecInfo->recycleRequests = requests >= 1.0 ? (epicsUInt32) requests : 0;
+      pExecInfo->recycleRss = rss > 0.0 ? (epicsUInt64) (rss * 1048576.0) : 0;
+   }
+
+   /* Extract singleflight if specified.
+    */
+   status = dbFindInfo (&entry, "SINGLEFLIGHT");
+   if ((status == 0) && entry.pinfonode) {
+      const char* singleflight = entry.pinfonode->string;
+      if (strcmp (singleflight, "true") == 0 && pExecInfo->detached) {
+         WARN ("SINGLEFLIGHT not applicable to detached MODE, ignored\n");
+      } else if (strcmp (singleflight, "true") == 0) {
+         pExecInfo->singleflight = true;
+         pExecInfo->sharedEvent = epicsEventCreate (epicsEventEmpty);
+      } else if (strcmp (singleflight, "false") != 0) {
+         WARN ("Invalid SINGLEFLIGHT '%s', using 'false'\n", singleflight);
+      }
+   }
+
+   /* Extract perf counters if specified.
+    */
+   status = dbFindInfo (&entry, "PERF");
+   if ((status == 0) && entry.pinfonode) {
+      const char* perf = entry.pinfonode->string;
+      if (strcmp (perf, "true") == 0 && pExecInfo->detached) {
+         WARN ("PERF not applicable to detached MODE, ignored\n");
+      } else if (strcmp (perf, "true") == 0) {
+         pExecInfo->perfEnabled = true;
+      } else if (strcmp (perf, "false") != 0) {
+         WARN ("Invalid PERF '%s', using 'false'\n", perf);
+      }
+   }
+
+   /* Extract warm up if specified.
+    */
+   status = dbFindInfo (&entry, "WARMUP");
+   if ((status == 0) && entry.pinfonode) {
+      const char* warmup = entry.pinfonode->string;
+      if (strcmp (warmup, "dry") == 0) {
+         pExecInfo->warmup = WARMUP_DRY;
+      } else if (strcmp (warmup, "worker") == 0 && pExecInfo->persistent) {
+         pExecInfo->warmup = WARMUP_WORKER;
+      } else if (strcmp (warmup, "none") != 0) {
+         WARN ("Invalid WARMUP '%s' for this MODE, ignored\n", warmup);
+      }
+   }
+
+   if (pExecInfo->warmup != WARMUP_NONE) {
+      callbackSetCallback (warmupRequest, &pExecInfo->warmupCallback);
+      callbackSetPriority (priorityLow, &pExecInfo->warmupCallback);
+      callbackSetUser (prec, &pExecInfo->warmupCallback);
+      ellAdd (&warmupList, &pExecInfo->node);
+
+      if (!warmupHookRegistered) {
+         initHookRegister (warmupHook);
+         warmupHookRegistered = true;
+      }
+   }
+
+   /* Extract latency alarm thresholds if specified.
+    */
+   getInfoDouble (prec, &entry, "LATENCY_MINOR", &pExecInfo->latencyMinor);
+   getInfoDouble (prec, &entry, "LATENCY_MAJOR", &pExecInfo->latencyMajor);
+
+   pExecInfo->latencyBasis = LATENCY_LAST;
+   status = dbFindInfo (&entry, "LATENCY_BASIS");
+   if ((status == 0) && entry.pinfonode) {
+      const char* basis = entry.pinfonode->string;
+      if (strcmp (basis, "p95") == 0) {
+         pExecInfo->latencyBasis = LATENCY_P95;
+      } else if (strcmp (basis, "last") != 0) {
+         WARN ("Invalid LATENCY_BASIS '%s', using 'last'\n", basis);
+      }
+   }
+
+   /* Extract the rate limit if specified.
+    */
+   if (getInfoDouble (prec, &entry, "MAXRATE", &pExecInfo->maxRate) &&
+       pExecInfo->maxRate <= 0.0) {
+      WARN ("MAXRATE must be positive, ignored\n");
+      pExecInfo->maxRate = 0.0;
+   }
+
+   pExecInfo->maxBurst = 1.0;
+   if (getInfoDouble (prec, &entry, "MAXBURST", &pExecInfo->maxBurst) &&
+       pExecInfo->maxBurst < 1.0) {
+      WARN ("MAXBURST must be at least 1, using 1\n");
+      pExecInfo->maxBurst = 1.0;
+   }
+
+   pExecInfo->tokens = pExecInfo->maxBurst;
+   pExecInfo->tokenTime = asubExecTraceNow ();
+
+   /* Extract the stagger of periodic executions if specified.
+    */
+   status = dbFindInfo (&entry, "STAGGER");
+   if ((status == 0) && entry.pinfonode) {
+      const char* stagger = entry.pinfonode->string;
+      if (strcmp (stagger, "hash") == 0) {
+         pExecInfo->stagger = STAGGER_HASH;
+      } else if (strcmp (stagger, "balanced") == 0) {
+         pExecInfo->stagger = STAGGER_BALANCED;
+      } else if (strcmp (stagger, "none") != 0) {
+         WARN ("Invalid STAGGER '%s', using 'none'\n", stagger);
+      }
+   }
+
+   pExecInfo->staggerSpan = 0.5;
+   if (getInfoDouble (prec, &entry, "STAGGER_SPAN", &pExecInfo->staggerSpan) &&
+       (pExecInfo->staggerSpan <= 0.0 || pExecInfo->staggerSpan > 1.0)) {
+      WARN ("STAGGER_SPAN must be in (0, 1], using 0.5\n");
+      pExecInfo->staggerSpan = 0.5;
+   }
+
+   pExecInfo->staggerFraction = staggerHash (prec->name);
+   if (pExecInfo->stagger == STAGGER_BALANCED && !staggerLock) {
+      staggerLock = epicsMutexMustCreate ();
+   }
+
+   callbackSetCallback (staggerStart, &pExecInfo->staggerCallback);
+   callbackSetPriority (priorityHigh, &pExecInfo->staggerCallback);
+   callbackSetUser (prec, &pExecInfo->staggerCallback);
+
+   callbackSetCallback (deferredStart, &pExecInfo->deferCallback);
+   callbackSetPriority (priorityLow, &pExecInfo->deferCallback);
+   callbackSetUser (prec, &pExecInfo->deferCallback);
+
+   callbackSetCallback (deferredRelease, &pExecInfo->releaseCallback);
+   callbackSetPriority (priorityHigh, &pExecInfo->releaseCallback);
+   callbackSetUser (prec, &pExecInfo->releaseCallback);
+
    /* Use record name as the task name.
     */
    pExecInfo->thread_id = epicsThreadCreate     /*  */
@@ -1141,7 +2407,7 @@ static long asubExecInit (aSubRecord* prec)
 
 /*------------------------------------------------------------------------------
  */
-static long asubExecProcess (aSubRecord* prec)
+long asubExecRequest (dbCommon* prec)
 {
    STANDARD_CHECK (-1);
 
@@ -1150,14 +2416,32 @@ static long asubExecProcess (aSubRecord* prec)
    DETAIL ("pact=%d\n", prec->pact);
 
    if (prec->pact == FALSE) {
-      /* wake up thread */
-      prec->pact = TRUE;
-      epicsEventSignal (pExecInfo->event);
       status = 0;
+
+      /* Defer if over the rate limit, or if a deferred re-process is already
+       * pending, in which case it will use the latest inputs.
+       */
+      double delay = 0.0;
+      if (!pExecInfo->deferPending && pExecInfo->maxRate > 0.0) {
+         delay = takeToken (pExecInfo);
+      }
+      if (pExecInfo->deferPending || delay > 0.0) {
+         deferRequest (prec, pExecInfo, delay);
+      } else {
+         /* wake up thread, now or at the record's phase of the scan period */
+         prec->pact = TRUE;
+         startRequest (prec, staggerDelay (prec));
+      }
    } else {
       /* thread is complete */
       status = pExecInfo->status;
       prec->pact = FALSE;
+
+      /* Latency alarms - TIMEOUT distinguishes these from failures (SOFT).
+       */
+      if (pExecInfo->latencySevr != NO_ALARM) {
+         recGblSetSevr (prec, TIMEOUT_ALARM, pExecInfo->latencySevr);
+      }
    }
 
    DETAIL ("pact=%d, status=%ld\n",prec->pact, status);
@@ -1166,10 +2450,28 @@ static long asubExecProcess (aSubRecord* prec)
 }
 
 
+/*------------------------------------------------------------------------------
+ * aSub record functions
+ *------------------------------------------------------------------------------
+ */
+static long asubExecInit (aSubRecord* prec)
+{
+   return asubExecAttach ((dbCommon*) prec, &aSubBinding);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static long asubExecProcess (aSubRecord* prec)
+{
+   return asubExecRequest ((dbCommon*) prec);
+}
+
+
 /* -----------------------------------------------------------------------------
  */
 epicsRegisterFunction (asubExecInit);
 epicsRegisterFunction (asubExecProcess);
 epicsExportAddress (int, asubExecDebug);
+epicsExportAddress (double, asubExecWarmupSpacing);
 
 /* end */
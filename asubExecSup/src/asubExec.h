@@ -43,6 +43,13 @@ extern "C" {
  */
 #define asubExecVersion  0x00010202
 
+/* Version 1.3.0 - counted frames, as used by the asubExec record.
+ * The version is followed by the number of inputs and the number of outputs
+ * (response: number of outputs only), both epicsUInt32, rather than implying
+ * 21 of each.
+ */
+#define asubExecVersionCounted  0x00010300
+
 /* Start and end text sent between EPICS IOC and the spanewd purpose.
  */
 #define asubExecStx "asubExec"
@@ -31,14 +31,23 @@
 #
 
 """
-The asubExec module provides the asubExecIO utility class.
+The asubExec module provides the asubExecIO utility class, and the
+asubExecServer class for persistent (long running) worker processes.
 """
 
 
+import asyncio
+import io
+import os
 import sys
 import struct
 from collections import namedtuple
 
+try:
+    import numpy
+except ImportError:
+    numpy = None    # STRING arrays are then decoded element by element
+
 
 class asubExecIO(object):
     """ asubExec IO utility class.
@@ -48,12 +57,20 @@ class asubExecIO(object):
         It must be consistant with the enum asubExecDataType together with the
         strings asubExecStx and  asubExecEtx out of asubExec.h
 
-        TBD: STRING and ENUM parameters.
+        STRING values are fixed width 40 byte, null terminated, elements and
+        are presented as python str values. ENUM values are presented as int.
+
+        Large outputs may instead be filled in place, avoiding python tuples
+        altogether - see allocate_outputs and pack_views.
     """
 
     # from asubExec.h
+    # Version 1.3 frames, as sent by the asubExec record, include the number of
+    # inputs and outputs, and the fields are keyed 'inp00', 'inp01' ... and
+    # 'out00', 'out01' ... rather than 'inpa' ... 'inpu' and 'outa' ... 'outu'.
     #
     asubExecVersion = (1, 2, 2)
+    asubExecVersionCounted = (1, 3, 0)
 
     asubExecTypeSTRING = 0    # STRING
     asubExecTypeCHAR = 1      # CHAR
@@ -80,13 +97,24 @@ class asubExecIO(object):
     Defines the DataTypeSpec naamed tuple.
     name is the EPICS data type name
     size is element size in bytes
-    format is the struct format string - we use native endieness
+    format is the struct element format string - we use native endieness
     ftype is the python data type - used as a casting callable.
+
+    Whole arrays are packed/unpacked with a single struct call, i.e. the element
+    format code is repeated using a count, e.g. "=8d", rather than one struct
+    call per element.
     """
     DataTypeSpec = namedtuple("DataTypeSpec", ('name', 'size', 'format', 'ftype'))
 
+    """
+    Text encoding used for STRING values. EPICS strings are max 39 characters
+    plus a null terminator.
+    """
+    StringEncoding = "utf8"
+    StringMaxLen = 39
+
     typeMap = {
-        asubExecTypeSTRING: DataTypeSpec("STRING", 40, None, str),
+        asubExecTypeSTRING: DataTypeSpec("STRING", 40, "=40s", str),
         asubExecTypeCHAR:   DataTypeSpec("CHAR",    1, "=b", int),
         asubExecTypeUCHAR:  DataTypeSpec("UCHAR",   1, "=B", int),
         asubExecTypeSHORT:  DataTypeSpec("SHORT",   2, "=h", int),
@@ -95,18 +123,20 @@ class asubExecIO(object):
         asubExecTypeULONG:  DataTypeSpec("ULONG",   4, "=I", int),
         asubExecTypeFLOAT:  DataTypeSpec("FLOAT",   4, "=f", float),
         asubExecTypeDOUBLE: DataTypeSpec("DOUBLE",  8, "=d", float),
-        asubExecTypeENUM:   DataTypeSpec("ENUM",    2, None, int),
+        asubExecTypeENUM:   DataTypeSpec("ENUM",    2, "=H", int),
         asubExecTypeINT64:  DataTypeSpec("INT64",   8, "=q", int),
         asubExecTypeUINT64: DataTypeSpec("UINT64",  8, "=Q", int)
     }
 
     def __init__(self):
         self._input_data = None
-        self._version = None
+        self._version = asubExecIO.asubExecVersion
+        self._output_keys = asubExecIO.Keys
         self._output_spec = {}
         self._raw_data = None
         self._ptr = None
         self._output_len = None
+        self._output_views = None
 
 
     @property
@@ -151,6 +181,15 @@ class asubExecIO(object):
         return self._output_spec
 
 
+    @property
+    def output_views(self):
+        """
+        Provides the writable output buffers allocated by allocate_outputs,
+        keyed as per output_spec, or None if not allocated.
+        """
+        return self._output_views
+
+
     @property
     def output_len(self):
         """ Output length in bytes """
@@ -179,9 +218,9 @@ class asubExecIO(object):
         input_size = len(self._raw_data)
         self.message("input data size : %d" % input_size)
 
-        # Need to calculate the abs min size
+        # Need to calculate the abs min size - stx, version and etx
         #
-        if input_size < 289:
+        if input_size < 16:
             self.message("input data stream type too short (len=%d)" % input_size)
             return False
 
@@ -195,15 +234,31 @@ class asubExecIO(object):
 
         self.message("input data stream version: %s" % str(version))
 
-        if version != asubExecIO.asubExecVersion:
-            self.message("unexpected input data stream, expecting: %s" %
-                         str(asubExecIO.asubExecVersion))
+        if version == asubExecIO.asubExecVersion:
+            input_keys = asubExecIO.Keys
+            output_keys = asubExecIO.Keys
+            if input_size < 289:
+                self.message("input data stream type too short (len=%d)" % input_size)
+                return False
+
+        elif version == asubExecIO.asubExecVersionCounted:
+            number_inputs, number_outputs = struct.unpack("=II", self._read(8))
+            input_keys = ["%02d" % j for j in range(number_inputs)]
+            output_keys = ["%02d" % j for j in range(number_outputs)]
+
+        else:
+            self.message("unexpected input data stream, expecting: %s or %s" %
+                         (str(asubExecIO.asubExecVersion),
+                          str(asubExecIO.asubExecVersionCounted)))
             return False
 
+        self._version = version
+        self._output_keys = output_keys
+
         # Unpack actual user application input data
         #
         arguments = {}
-        for key in asubExecIO.Keys:
+        for key in input_keys:
             field = "inp%s" % key
 
             # Read the data type
@@ -217,10 +272,6 @@ class asubExecIO(object):
 
 #           self.message (key, kind, spec)
 
-            if spec.format is None:
-                self.message("%s Unhandled type %s\n" % (field, spec.name))
-                return False
-
             item = self._read_array(spec)
             arguments[field] = item
 
@@ -229,7 +280,7 @@ class asubExecIO(object):
         # Unpack specification application output data
         #
         arguments = {}
-        for key in asubExecIO.Keys:
+        for key in output_keys:
             field = "out%s" % key
 
             kind = struct.unpack("=H", self._read(2))[0]
@@ -243,7 +294,7 @@ class asubExecIO(object):
         #
         etx = self._read_epilog()
         if etx != asubExecIO.asubExecEtx:
-            self.message("input data not terminated: '%s'  %d / %d " % (etx, self._ptr, len(data)))
+            self.message("input data not terminated: '%s'  %d / %d " % (etx, self._ptr, input_size))
             return False
 
         return True
@@ -270,7 +321,7 @@ class asubExecIO(object):
 
         self._write_prolog()
 
-        for key in asubExecIO.Keys:
+        for key in self._output_keys:
             field = "out%s" % key
 
             out_spec = self._output_spec[field]
@@ -285,11 +336,11 @@ class asubExecIO(object):
             item = output.get(field, None)
             if item is None:
                 ftype = spec.ftype
-                if isinstance(ftype, float):
+                if ftype is float:
                     item = (0.0, )
-                elif isinstance(ftype, int):
+                elif ftype is int:
                     item = (0, )
-                elif isinstance(ftype, str):
+                elif ftype is str:
                     item = ("", )
                 else:
                     item = None
@@ -310,6 +361,98 @@ class asubExecIO(object):
         return True
 
 
+    # -------------------------------------------------------------------------
+    #
+    def allocate_outputs(self):
+        """
+        Allocates a zeroed, writable buffer for each output, sized and typed as
+        per output_spec, and returns them as a dictionary of memoryviews, keyed
+        'outa', outb', ... 'outu'. This is also available using the output_views
+        property.
+
+        Numeric views are cast to the element type, so view[j] = value stores
+        the value directly, and numpy.frombuffer(view, dtype=...) provides a
+        numpy array sharing the buffer. STRING views are the raw 40 byte
+        elements, see set_string.
+
+        Once filled in place, the outputs are sent using pack_views.
+        Returns None if an output type is not handled.
+        """
+        views = {}
+        for key in self._output_keys:
+            field = "out%s" % key
+
+            out_spec = self._output_spec[field]
+            kind = out_spec['kind']
+            number = out_spec['number']
+
+            spec = asubExecIO.typeMap.get(kind, None)
+            if spec is None:
+                self.message("%s Unhandled type %s\n" % (field, kind))
+                return None
+
+            view = memoryview(bytearray(number * spec.size))
+            if spec.ftype is not str:
+                view = view.cast(spec.format[1:])
+            views[field] = view
+
+        self._output_views = views
+        return views
+
+    # -------------------------------------------------------------------------
+    #
+    def set_string(self, field, index, value):
+        """
+        Sets element index of the STRING output view for field, e.g. 'outa',
+        truncated and null padded as per pack.
+        """
+        size = asubExecIO.typeMap[asubExecIO.asubExecTypeSTRING].size
+        raw = asubExecIO._encode_string(value)
+        self._output_views[field][index * size:(index + 1) * size] = raw.ljust(size, b"\0")
+
+    # -------------------------------------------------------------------------
+    #
+    def pack_views(self, target=sys.stdout.buffer, numbers=None):
+        """
+        Packs the output views, as filled in place, into the target buffer.
+        The views themselves are written, not copies, using a single vectored
+        write (os.writev) if the target is a file.
+
+        numbers optionally specifies, keyed by field, the number of elements to
+        send; by default all elements (as per output_spec) are sent.
+
+        pack_views returns True if successfull.
+        """
+        if self._output_views is None:
+            self.message("pack_views: outputs not allocated")
+            return False
+
+        self._raw_output = bytearray()
+        self._write_prolog()
+        buffers = [bytes(self._raw_output)]
+
+        for key in self._output_keys:
+            field = "out%s" % key
+
+            kind = self._output_spec[field]['kind']
+            spec = asubExecIO.typeMap[kind]
+            view = self._output_views[field].cast("B")
+
+            maximum = len(view) // spec.size
+            number = maximum
+            if numbers is not None and field in numbers:
+                number = max(0, min(int(numbers[field]), maximum))
+
+            buffers.append(struct.pack("=HI", kind, number))
+            buffers.append(view[:number * spec.size])
+
+        buffers.append(asubExecIO.asubExecEtx.encode(encoding="utf8"))
+
+        self._output_len = sum(len(buffer) for buffer in buffers)
+        self._writev(target, buffers)
+        return True
+
+
     # -------------------------------------------------------------------------
     #
     @staticmethod
@@ -371,12 +514,28 @@ class asubExecIO(object):
         """
         number = struct.unpack("=I", self._read(4))[0]
 
-        result = []
-        for j in range(number):
-            value = struct.unpack(spec.format, self._read(spec.size))[0]
-            result.append(value)
+        # One slice for the whole array.
+        #
+        raw = self._read(number * spec.size)
+
+        if spec.ftype is str:
+            # Each element is a fixed width null terminated string. Anything
+            # after the first null is undefined, so it must be discarded.
+            #
+            encoding = asubExecIO.StringEncoding
+            if numpy is not None and number > 0:
+                # Whole array at once: zero everything from the first null on,
+                # then decode as fixed width (null padded) byte strings.
+                #
+                chars = numpy.frombuffer(raw, dtype=numpy.uint8).reshape(number, spec.size)
+                chars = chars * numpy.cumprod(chars != 0, axis=1, dtype=numpy.uint8)
+                items = chars.view("S%d" % spec.size).ravel()
+                return tuple(numpy.char.decode(items, encoding, errors="replace").tolist())
 
-        return tuple(result)
+            return tuple(item.partition(b"\0")[0].decode(encoding, errors="replace")
+                         for (item,) in struct.iter_unpack(spec.format, raw))
+
+        return struct.unpack(asubExecIO._array_format(spec, number), raw)
 
 
     # -------------------------------------------------------------------------
@@ -385,6 +544,40 @@ class asubExecIO(object):
         self._raw_output.extend(item)
 
 
+    # -------------------------------------------------------------------------
+    #
+    @staticmethod
+    def _writev(target, buffers):
+        """
+        Writes the list of buffers to target - with os.writev if the target is
+        a file, else one write per buffer (e.g. io.BytesIO).
+        """
+        try:
+            fd = target.fileno()
+        except (AttributeError, io.UnsupportedOperation):
+            fd = None
+
+        if fd is None or not hasattr(os, "writev"):
+            for buffer in buffers:
+                target.write(buffer)
+            return
+
+        # Anything already buffered must go first.
+        #
+        target.flush()
+
+        while buffers:
+            written = os.writev(fd, buffers)
+
+            # Skip what has been written, in case of a partial write.
+            #
+            while buffers and written >= len(buffers[0]):
+                written -= len(buffers[0])
+                buffers.pop(0)
+            if written > 0:
+                buffers[0] = memoryview(buffers[0])[written:]
+
+
     # -------------------------------------------------------------------------
     #
     def _write_prolog(self):
@@ -394,11 +587,16 @@ class asubExecIO(object):
         stx = asubExecIO.asubExecStx.encode(encoding="utf8")
         self._write(stx)
 
-        version = asubExecIO.asubExecVersion
+        # Reply in the version received.
+        #
+        version = self._version
         v = (version[0] << 16) + (version[1] << 8) + version[2]
         t = struct.pack("=I", v)
         self._write(t)
 
+        if version == asubExecIO.asubExecVersionCounted:
+            self._write(struct.pack("=I", len(self._output_keys)))
+
 
     # -------------------------------------------------------------------------
     #
@@ -428,10 +626,318 @@ class asubExecIO(object):
         t = struct.pack("=I", number)
         self._write(t)
 
-        for j in range(number):
-            # The ftype is its own convert function
+        if spec.ftype is str:
+            # Truncate as required, leaving room for the null terminator, and
+            # null pad out each element to its fixed width.
             #
-            t = struct.pack(spec.format, spec.ftype(item[j]))
+            t = b"".join(asubExecIO._encode_string(item[j]).ljust(spec.size, b"\0")
+                         for j in range(number))
             self._write(t)
+            return
+
+        # The ftype is its own convert function
+        #
+        ftype = spec.ftype
+        t = struct.pack(asubExecIO._array_format(spec, number),
+                        *[ftype(item[j]) for j in range(number)])
+        self._write(t)
+
+
+    # -------------------------------------------------------------------------
+    #
+    @staticmethod
+    def _encode_string(value):
+        """ Returns the encoded value truncated to at most StringMaxLen bytes on
+            a character boundary, so that a multibyte character is never split.
+        """
+        encoding = asubExecIO.StringEncoding
+        raw = str(value).encode(encoding)
+        if len(raw) <= asubExecIO.StringMaxLen:
+            return raw
+        return raw[:asubExecIO.StringMaxLen].decode(encoding, errors="ignore").encode(encoding)
+
+    # -------------------------------------------------------------------------
+    #
+    @staticmethod
+    def _array_format(spec, number):
+        """ Returns the struct format string for an array of number elements,
+            e.g. "=d" and 8 yields "=8d".
+            Not applicable to STRING.
+        """
+        return "%s%d%s" % (spec.format[0], number, spec.format[1:])
+
+
+
+class asubExecServer(object):
+    """ asyncio based server for persistent asubExec worker processes.
+
+        Rather than one process per execution, a persistent worker receives a
+        stream of tagged request frames. Each tagged frame is a 4 byte request
+        id (epicsUInt32, native endieness) followed by a standard asubExec
+        input frame. The response is the same request id followed by a standard
+        asubExec output frame.
+
+        Requests are dispatched concurrently as they arrive, and responses are
+        written as they complete, i.e. not necessarily in request order. The
+        request id is used to match responses to requests.
+
+        If a request cannot be unpacked or the handler fails, the response is a
+        short frame, i.e. just stx, version and etx, which signifies failure.
+
+        A counted frame with no inputs and no outputs is a ready probe, sent to
+        a replacement worker before it is used, and is answered with an empty
+        counted frame without invoking the handler.
+
+        The handler is called as handler(input_data, output_spec) and returns
+        the output dictionary as expected by asubExecIO.pack. The handler may
+        be a coroutine function, in which case it is awaited directly.
+        Otherwise it is run in the given executor (a concurrent.futures thread
+        or process pool); the default executor is the event loop's default
+        thread pool. Use a process pool for CPU bound handlers; the handler
+        must then be picklable, i.e. a module level function.
+
+        Example:
+
+            def mid_points(input_data, output_spec):
+                inpa = input_data['inpa']
+                return {'outa': [(a + b) / 2.0 for a, b in zip(inpa, inpa[1:])]}
+
+            asubExecServer(mid_points).run()
+    """
+
+    TagFormat = "=I"
+    TagSize = 4
+
+    def __init__(self, handler, executor=None, max_concurrent=16):
+        self._handler = handler
+        self._executor = executor
+        self._max_concurrent = max_concurrent
+        self._semaphore = None
+        self._requests = 0
+        self._failures = 0
+
+
+    @property
+    def requests(self):
+        """ Number of requests received """
+        return self._requests
+
+
+    @property
+    def failures(self):
+        """ Number of requests that failed """
+        return self._failures
+
+    # -------------------------------------------------------------------------
+    #
+    def run(self):
+        """
+        Serve requests on standard input/output until standard input is closed.
+        """
+        asyncio.run(self.serve_stdio())
+
+    # -------------------------------------------------------------------------
+    #
+    async def serve_stdio(self):
+        """
+        Serve requests read from standard input, writing responses to
+        standard output.
+        """
+        loop = asyncio.get_running_loop()
+
+        reader = asyncio.StreamReader()
+        await loop.connect_read_pipe(lambda: asyncio.StreamReaderProtocol(reader),
+                                    sys.stdin.buffer)
+
+        transport, protocol = await loop.connect_write_pipe(
+            asyncio.streams.FlowControlMixin, sys.stdout.buffer)
+        writer = asyncio.StreamWriter(transport, protocol, reader, loop)
+
+        await self.serve(reader, writer)
+
+    # -------------------------------------------------------------------------
+    #
+    async def serve_unix(self, path):
+        """
+        Serve requests from connections made to the unix domain socket path.
+        Each connection is an independent stream of tagged frames.
+        """
+        server = await asyncio.start_unix_server(self.serve, path=path)
+        async with server:
+            await server.serve_forever()
+
+    # -------------------------------------------------------------------------
+    #
+    async def serve(self, reader, writer):
+        """
+        Serve tagged requests from reader until end of input, writing tagged
+        responses to writer. Waits for all outstanding requests to complete.
+        """
+        if self._semaphore is None:
+            self._semaphore = asyncio.Semaphore(self._max_concurrent)
+
+        tasks = set()
+        while True:
+            try:
+                tag, frame = await self.read_frame(reader)
+            except asyncio.IncompleteReadError:
+                break    # end of input - the normal way out
+            except ValueError as error:
+                # We can't resynchronise the stream, so we are done.
+                #
+                asubExecIO.message("asubExecServer: %s" % error)
+                break
+
+            if frame == self._ready_frame():
+                writer.write(struct.pack(asubExecServer.TagFormat, tag) +
+                             self._ready_response())
+                await writer.drain()
+                continue
+
+            self._requests += 1
+
+            await self._semaphore.acquire()
+            task = asyncio.ensure_future(self._dispatch(tag, frame, writer))
+            tasks.add(task)
+            task.add_done_callback(tasks.discard)
+
+        if tasks:
+            await asyncio.gather(*tasks)
+
+        writer.close()
+
+    # -------------------------------------------------------------------------
+    #
+    @staticmethod
+    async def read_frame(reader):
+        """
+        Reads one tagged request frame from the reader.
+        Returns the tuple (tag, frame), where frame is the raw frame bytes as
+        expected by asubExecIO.unpack.
+        """
+        tag = struct.unpack(asubExecServer.TagFormat,
+                            await reader.readexactly(asubExecServer.TagSize))[0]
+
+        # The frame is self describing - we use the type and number of elements
+        # of each input to determine how much to read.
+        #
+        prolog = await reader.readexactly(12)    # stx and version
+        parts = [prolog]
+
+        v = struct.unpack("=I", prolog[8:12])[0]
+        version = ((v >> 16) & 255, (v >> 8) & 255, v & 255)
+
+        number_inputs = number_outputs = len(asubExecIO.Keys)
+        if version == asubExecIO.asubExecVersionCounted:
+            counts = await reader.readexactly(8)
+            number_inputs, number_outputs = struct.unpack("=II", counts)
+            parts.append(counts)
+
+        for j in range(number_inputs):
+            header = await reader.readexactly(6)
+            kind, number = struct.unpack("=HI", header)
+            spec = asubExecIO.typeMap.get(kind, None)
+            if spec is None:
+                raise ValueError("input %d unhandled type %s" % (j, kind))
+            parts.append(header)
+            parts.append(await reader.readexactly(number * spec.size))
+
+        parts.append(await reader.readexactly(6 * number_outputs + 4))
+
+        return tag, b"".join(parts)
+
+    # -------------------------------------------------------------------------
+    #
+    async def _dispatch(self, tag, frame, writer):
+        """
+        Unpacks the request, invokes the handler and writes the tagged response.
+        """
+        try:
+            response = await self._execute(frame)
+        finally:
+            self._semaphore.release()
+
+        if response is None:
+            self._failures += 1
+            response = self._failure_frame()
+
+        # A single write per response, so responses never interleave.
+        #
+        writer.write(struct.pack(asubExecServer.TagFormat, tag) + response)
+        await writer.drain()
+
+    # -------------------------------------------------------------------------
+    #
+    async def _execute(self, frame):
+        """
+        Returns the packed response frame or None on failure. Any exception,
+        including output that does not match the output types, fails just this
+        request, never the worker.
+        """
+        exec_io = asubExecIO()
+        try:
+            if not exec_io.unpack(io.BytesIO(frame)):
+                return None
+        except Exception as error:
+            asubExecIO.message("asubExecServer: unpack failed: %s" % error)
+            return None
+
+        try:
+            if asyncio.iscoroutinefunction(self._handler):
+                output = await self._handler(exec_io.input_data, exec_io.output_spec)
+            else:
+                loop = asyncio.get_running_loop()
+                output = await loop.run_in_executor(self._executor, self._handler,
+                                                    exec_io.input_data, exec_io.output_spec)
+        except Exception as error:
+            asubExecIO.message("asubExecServer: handler failed: %s" % error)
+            return None
+
+        try:
+            target = io.BytesIO()
+            if not exec_io.pack(output, target):
+                return None
+        except Exception as error:
+            asubExecIO.message("asubExecServer: pack failed: %s" % error)
+            return None
+
+        return target.getvalue()
+
+    # -------------------------------------------------------------------------
+    #
+    @staticmethod
+    def _ready_frame():
+        """
+        A ready probe - counted frame with no inputs and no outputs.
+        """
+        version = asubExecIO.asubExecVersionCounted
+        v = (version[0] << 16) + (version[1] << 8) + version[2]
+        return (asubExecIO.asubExecStx.encode(encoding="utf8") +
+                struct.pack("=III", v, 0, 0) +
+                asubExecIO.asubExecEtx.encode(encoding="utf8"))
+
+    @staticmethod
+    def _ready_response():
+        """
+        The response to a ready probe - counted frame with no outputs.
+        """
+        version = asubExecIO.asubExecVersionCounted
+        v = (version[0] << 16) + (version[1] << 8) + version[2]
+        return (asubExecIO.asubExecStx.encode(encoding="utf8") +
+                struct.pack("=II", v, 0) +
+                asubExecIO.asubExecEtx.encode(encoding="utf8"))
+
+    # -------------------------------------------------------------------------
+    #
+    @staticmethod
+    def _failure_frame():
+        """
+        A short frame - stx, version and etx only.
+        """
+        version = asubExecIO.asubExecVersion
+        v = (version[0] << 16) + (version[1] << 8) + version[2]
+        return (asubExecIO.asubExecStx.encode(encoding="utf8") +
+                struct.pack("=I", v) +
+                asubExecIO.asubExecEtx.encode(encoding="utf8"))
 
  # end
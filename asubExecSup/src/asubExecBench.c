@@ -0,0 +1,355 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecBench.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Microbenchmarks for the asubExec execution engine (asubExecCore.c) covering
+ * frame encode and decode, type conversion and child process creation.
+ * Does not require EPICS or an IOC.
+ *
+ * usage: asubExecBench [-n scale] [-s]
+ *   -n scale  multiply the number of iterations by scale (default 1)
+ *   -s        skip the child process (spawn) benchmarks
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include "asubExecCore.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define NUMBER_FIELDS      21
+#define ARRAY_ELEMENTS     1000
+#define CONVERT_ELEMENTS   (1024 * 1024)
+
+typedef void (*BenchFunction) (void* context);
+
+/* Frame test data
+ */
+typedef struct FrameContext {
+   asubExecField inputs [NUMBER_FIELDS];
+   asubExecField outputs [NUMBER_FIELDS];
+   asubExecDataType encodeTypes [NUMBER_FIELDS];
+   asubExecBuffer frame;
+   asubExecBuffer response;
+} FrameContext;
+
+typedef struct ConvertContext {
+   asubExecDataType dstType;
+   void* dst;
+   asubExecDataType srcType;
+   void* src;
+} ConvertContext;
+
+typedef struct SpawnContext {
+   asubExecBackend backend;
+   const char* const* argv;
+   FrameContext* frame;          /* for round trips only */
+} SpawnContext;
+
+static int scale = 1;
+
+
+/*------------------------------------------------------------------------------
+ * Runs function iterations times and reports time per iteration and, if
+ * bytes is non zero, throughput.
+ */
+static void bench (const char* name, const int iterations, const size_t bytes,
+                   BenchFunction function, void* context)
+{
+   const int n = iterations * scale;
+   uint64_t start;
+   double elapsed;
+   int j;
+
+   function (context);          /* warm up */
+
+   start = asubExecMonotonicNow ();
+   for (j = 0; j < n; j++) {
+      function (context);
+   }
+   elapsed = (double) (asubExecMonotonicNow () - start) * 1.0e-9;
+
+   printf ("%-32s %9d %12.1f ns/op", name, n, 1.0e9 * elapsed / n);
+   if (bytes > 0) {
+      printf (" %10.1f MB/s", (double) bytes * n / elapsed / 1.0e6);
+   }
+   printf ("\n");
+}
+
+/*------------------------------------------------------------------------------
+ * Set up NUMBER_FIELDS double fields, each of number elements, used both as
+ * inputs and outputs, and encode a matching response frame.
+ */
+static void frameSetup (FrameContext* context, const uint32_t number)
+{
+   const size_t etxLen = strlen (asubExecEtx);
+   int j;
+   uint32_t k;
+
+   memset (context, 0, sizeof (*context));
+
+   for (j = 0; j < NUMBER_FIELDS; j++) {
+      double* data = (double*) calloc (number, sizeof (double));
+      for (k = 0; k < number; k++) data [k] = j + 0.001 * k;
+
+      context->inputs[j].type = asubExecTypeDOUBLE;
+      context->inputs[j].number = number;
+      context->inputs[j].data = data;
+
+      context->outputs[j].type = asubExecTypeDOUBLE;
+      context->outputs[j].number = number;
+      context->outputs[j].data = calloc (number, sizeof (double));
+
+      context->encodeTypes[j] = asubExecTypeFLOAT;
+   }
+
+   /* A response frame is an input frame without the output specification.
+    */
+   asubExecEncodeWith (&context->response, false, context->inputs, NUMBER_FIELDS, NULL, NULL,
+                       context->outputs, NUMBER_FIELDS);
+   context->response.size -= NUMBER_FIELDS * (sizeof (int16_t) + sizeof (uint32_t)) + etxLen;
+   asubExecBufferAppend (&context->response, asubExecEtx, etxLen);
+
+   asubExecEncodeWith (&context->frame, false, context->inputs, NUMBER_FIELDS, NULL, NULL,
+                       context->outputs, NUMBER_FIELDS);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void frameCleanup (FrameContext* context)
+{
+   int j;
+
+   for (j = 0; j < NUMBER_FIELDS; j++) {
+      free (context->inputs[j].data);
+      free (context->outputs[j].data);
+   }
+   asubExecBufferFree (&context->frame);
+   asubExecBufferFree (&context->response);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void encodeFunction (void* context)
+{
+   FrameContext* fc = (FrameContext*) context;
+   asubExecEncodeWith (&fc->frame, false, fc->inputs, NUMBER_FIELDS, NULL, NULL,
+                       fc->outputs, NUMBER_FIELDS);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void encodeAsFunction (void* context)
+{
+   FrameContext* fc = (FrameContext*) context;
+   asubExecEncodeWith (&fc->frame, false, fc->inputs, NUMBER_FIELDS, fc->encodeTypes, NULL,
+                       fc->outputs, NUMBER_FIELDS);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void frameLengthFunction (void* context)
+{
+   FrameContext* fc = (FrameContext*) context;
+   size_t length;
+   asubExecFrameLength (fc->response.data, fc->response.size, NUMBER_FIELDS, &length);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void decodeFunction (void* context)
+{
+   FrameContext* fc = (FrameContext*) context;
+   asubExecDecodeWith (fc->response.data, fc->response.size, fc->outputs, NUMBER_FIELDS,
+                       NULL, NULL, NULL);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void convertFunction (void* context)
+{
+   ConvertContext* cc = (ConvertContext*) context;
+   asubExecConvert (cc->dstType, cc->dst, cc->srcType, cc->src, CONVERT_ELEMENTS);
+}
+
+/*------------------------------------------------------------------------------
+ * Start and reap a child process.
+ */
+static void spawnFunction (void* context)
+{
+   SpawnContext* sc = (SpawnContext*) context;
+   asubExecChild child;
+
+   if (!asubExecChildStart (&child, sc->backend, sc->argv)) return;
+   close (child.fdput);
+   close (child.fdget);
+   asubExecChildReap (&child, 10.0, 20.0, NULL);
+}
+
+/*------------------------------------------------------------------------------
+ * Full execution: start, write frame, read response, decode and reap.
+ * The child, cat, echos the canned response.
+ */
+static void roundTripFunction (void* context)
+{
+   SpawnContext* sc = (SpawnContext*) context;
+   FrameContext* fc = sc->frame;
+   asubExecChild child;
+   asubExecDeadline deadline;
+   asubExecStatus status;
+
+   if (!asubExecChildStart (&child, sc->backend, sc->argv)) return;
+   asubExecDeadlineSet (&deadline, 10.0);
+
+   asubExecChildWrite (&child, fc->response.data, fc->response.size, &deadline, NULL);
+   status = asubExecChildRead (&child, &fc->frame, NUMBER_FIELDS, &deadline, NULL);
+   if (status == asubExecOkay) {
+      asubExecDecodeWith (fc->frame.data, fc->frame.size, fc->outputs, NUMBER_FIELDS,
+                          NULL, NULL, NULL);
+   } else {
+      fprintf (stderr, "round trip failed: %s\n", asubExecStatusText (status));
+   }
+   asubExecChildReap (&child, 10.0, 20.0, NULL);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void frameBenchmarks (const uint32_t number)
+{
+   FrameContext context;
+   char name [40];
+
+   frameSetup (&context, number);
+
+   snprintf (name, sizeof (name), "encode %dx%u double", NUMBER_FIELDS, number);
+   bench (name, number > 1 ? 2000 : 200000, context.frame.size, encodeFunction, &context);
+
+   snprintf (name, sizeof (name), "encode %dx%u double as float", NUMBER_FIELDS, number);
+   bench (name, number > 1 ? 2000 : 200000, context.frame.size, encodeAsFunction, &context);
+
+   snprintf (name, sizeof (name), "frame length %dx%u double", NUMBER_FIELDS, number);
+   bench (name, 200000, 0, frameLengthFunction, &context);
+
+   snprintf (name, sizeof (name), "decode %dx%u double", NUMBER_FIELDS, number);
+   bench (name, number > 1 ? 2000 : 200000, context.response.size, decodeFunction, &context);
+
+   frameCleanup (&context);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void convertBenchmark (const char* name,
+                              const asubExecDataType dstType,
+                              const asubExecDataType srcType)
+{
+   ConvertContext context;
+
+   context.dstType = dstType;
+   context.srcType = srcType;
+   context.dst = calloc (CONVERT_ELEMENTS, asubExecTypeSize (dstType));
+   context.src = calloc (CONVERT_ELEMENTS, asubExecTypeSize (srcType));
+
+   bench (name, 200, CONVERT_ELEMENTS * asubExecTypeSize (srcType),
+          convertFunction, &context);
+
+   free (context.dst);
+   free (context.src);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void spawnBenchmarks (void)
+{
+   static const char* const trueArgv [] = { "true", NULL };
+   static const char* const catArgv [] = { "cat", NULL };
+   FrameContext frame;
+   SpawnContext context;
+
+   frameSetup (&frame, 100);
+
+   context.argv = trueArgv;
+   context.frame = &frame;
+
+   context.backend = asubExecBackendFork;
+   bench ("spawn fork", 200, 0, spawnFunction, &context);
+   context.backend = asubExecBackendSpawn;
+   bench ("spawn posix_spawn", 200, 0, spawnFunction, &context);
+
+   context.argv = catArgv;
+
+   context.backend = asubExecBackendFork;
+   bench ("round trip fork 21x100", 200, frame.response.size, roundTripFunction, &context);
+   context.backend = asubExecBackendSpawn;
+   bench ("round trip posix_spawn 21x100", 200, frame.response.size,
+          roundTripFunction, &context);
+
+   frameCleanup (&frame);
+}
+
+/*------------------------------------------------------------------------------
+ */
+int main (int argc, char* argv [])
+{
+   bool doSpawn = true;
+   int opt;
+
+   while ((opt = getopt (argc, argv, "n:s")) != -1) {
+      switch (opt) {
+         case 'n':
+            scale = atoi (optarg);
+            if (scale < 1) scale = 1;
+            break;
+         case 's':
+            doSpawn = false;
+            break;
+         default:
+            fprintf (stderr, "usage: %s [-n scale] [-s]\n", argv [0]);
+            return 2;
+      }
+   }
+
+   printf ("%-32s %9s %15s %13s\n", "benchmark", "n", "time", "throughput");
+
+   frameBenchmarks (1);
+   frameBenchmarks (ARRAY_ELEMENTS);
+
+   convertBenchmark ("convert 1M double to float", asubExecTypeFLOAT, asubExecTypeDOUBLE);
+   convertBenchmark ("convert 1M long to double", asubExecTypeDOUBLE, asubExecTypeLONG);
+   convertBenchmark ("convert 1M ushort to double", asubExecTypeDOUBLE, asubExecTypeUSHORT);
+   convertBenchmark ("convert 1M double to double", asubExecTypeDOUBLE, asubExecTypeDOUBLE);
+
+   if (doSpawn) spawnBenchmarks ();
+
+   return 0;
+}
+
+/* end */
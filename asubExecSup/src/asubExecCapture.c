@@ -0,0 +1,229 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecCapture.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Frame capture - see asubExecCapture.h
+ *
+ * IOC shell usage:
+ *
+ *   asubExecCaptureStart ("/tmp/midpt.cap", "MIDPT:*", 1000)
+ *   asubExecCaptureStop
+ *
+ * The record pattern is a glob pattern. The last argument limits the number of
+ * executions captured (0 for no limit), after which capture stops.
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include "asubExecCapture.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <epicsExport.h>
+#include <epicsMutex.h>
+#include <epicsString.h>
+#include <epicsThread.h>
+#include <errlog.h>
+#include <iocsh.h>
+
+static epicsMutexId captureLock = NULL;
+static epicsThreadOnceId captureOnce = EPICS_THREAD_ONCE_INIT;
+
+/* The generation is incremented each time capture is started or stopped.
+ * Zero means never started.
+ */
+static epicsUInt32 captureGeneration = 0;
+static FILE* captureFile = NULL;
+static char* capturePattern = NULL;
+static int captureLimit = 0;
+static int captureCount = 0;
+
+
+/*------------------------------------------------------------------------------
+ */
+static void captureInit (void* arg)
+{
+   captureLock = epicsMutexMustCreate ();
+}
+
+/*------------------------------------------------------------------------------
+ * Called with the lock held.
+ */
+static void captureClose (void)
+{
+   if (captureFile) {
+      fclose (captureFile);
+      printf ("asubExecCapture: %d executions captured\n", captureCount);
+   }
+   captureFile = NULL;
+   free (capturePattern);
+   capturePattern = NULL;
+   __atomic_add_fetch (&captureGeneration, 1, __ATOMIC_RELEASE);
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecCaptureSelected (const char* recordName, epicsUInt32* generation,
+                              bool* selected)
+{
+   const epicsUInt32 current = __atomic_load_n (&captureGeneration, __ATOMIC_ACQUIRE);
+
+   /* The fast path - nothing has changed.
+    */
+   if (*generation == current) return *selected;
+
+   epicsThreadOnce (&captureOnce, captureInit, NULL);
+
+   epicsMutexMustLock (captureLock);
+   *selected = captureFile && capturePattern && epicsStrGlobMatch (recordName, capturePattern);
+   *generation = current;
+   epicsMutexUnlock (captureLock);
+
+   return *selected;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecCaptureWrite (const char* recordName, const asubExecTrace* trace,
+                           const void* input, const size_t inputSize,
+                           const void* output, const size_t outputSize)
+{
+   asubExecCaptureEntry entry;
+   const epicsUInt64 queued = trace->time [asubExecPhaseQueued];
+   const epicsUInt64 reaped = trace->time [asubExecPhaseReaped];
+
+   memset (&entry, 0, sizeof (entry));
+   strncpy (entry.record, recordName, sizeof (entry.record) - 1);
+   entry.queued = queued;
+   entry.latency = (queued && reaped > queued) ? reaped - queued : 0;
+   entry.exitCode = trace->exitCode;
+   entry.flags = trace->flags;
+   entry.inputSize = inputSize;
+   entry.outputSize = outputSize;
+
+   epicsThreadOnce (&captureOnce, captureInit, NULL);
+
+   epicsMutexMustLock (captureLock);
+   if (captureFile) {
+      fwrite (&entry, sizeof (entry), 1, captureFile);
+      fwrite (input, 1, inputSize, captureFile);
+      fwrite (output, 1, outputSize, captureFile);
+      captureCount++;
+
+      if (captureLimit > 0 && captureCount >= captureLimit) {
+         captureClose ();
+      }
+   }
+   epicsMutexUnlock (captureLock);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void asubExecCaptureStart (const char* filename, const char* pattern, int limit)
+{
+   asubExecCaptureHeader header;
+
+   if (!filename || !filename[0]) {
+      printf ("usage: asubExecCaptureStart filename [record_pattern [limit]]\n");
+      return;
+   }
+
+   epicsThreadOnce (&captureOnce, captureInit, NULL);
+
+   epicsMutexMustLock (captureLock);
+   captureClose ();
+
+   captureFile = fopen (filename, "wb");
+   if (!captureFile) {
+      errlogPrintf ("asubExecCaptureStart: fopen (%s) failed: %s\n", filename, strerror (errno));
+      epicsMutexUnlock (captureLock);
+      return;
+   }
+
+   memset (&header, 0, sizeof (header));
+   memcpy (header.magic, asubExecCaptureMagic, sizeof (header.magic));
+   header.version = asubExecCaptureVersion;
+   header.entrySize = sizeof (asubExecCaptureEntry);
+   fwrite (&header, sizeof (header), 1, captureFile);
+
+   capturePattern = epicsStrDup (pattern && pattern[0] ? pattern : "*");
+   captureLimit = limit;
+   captureCount = 0;
+   __atomic_add_fetch (&captureGeneration, 1, __ATOMIC_RELEASE);
+
+   printf ("asubExecCaptureStart: capturing %s to %s\n", capturePattern, filename);
+   epicsMutexUnlock (captureLock);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void asubExecCaptureStop (void)
+{
+   epicsThreadOnce (&captureOnce, captureInit, NULL);
+
+   epicsMutexMustLock (captureLock);
+   captureClose ();
+   epicsMutexUnlock (captureLock);
+}
+
+
+/*------------------------------------------------------------------------------
+ * IOC shell command registration
+ *------------------------------------------------------------------------------
+ */
+static const iocshArg startArg0 = { "filename", iocshArgString };
+static const iocshArg startArg1 = { "record_pattern", iocshArgString };
+static const iocshArg startArg2 = { "limit", iocshArgInt };
+static const iocshArg* const startArgs [] = { &startArg0, &startArg1, &startArg2 };
+static const iocshFuncDef startFuncDef = { "asubExecCaptureStart", 3, startArgs };
+
+static void startCallFunc (const iocshArgBuf* args)
+{
+   asubExecCaptureStart (args[0].sval, args[1].sval, args[2].ival);
+}
+
+static const iocshFuncDef stopFuncDef = { "asubExecCaptureStop", 0, NULL };
+
+static void stopCallFunc (const iocshArgBuf* args)
+{
+   asubExecCaptureStop ();
+}
+
+static void asubExecCaptureRegister (void)
+{
+   iocshRegister (&startFuncDef, startCallFunc);
+   iocshRegister (&stopFuncDef, stopCallFunc);
+}
+
+epicsExportRegistrar (asubExecCaptureRegister);
+
+/* end */
@@ -0,0 +1,91 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecCapture.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Frame capture - records the exact input frames sent to, and the responses
+ * received from, the child processes of selected records into a compact binary
+ * file. These may be replayed offline using asubExecReplay.py
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_CAPTURE_H
+#define ASUB_EXEC_CAPTURE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <epicsTypes.h>
+#include "asubExecTrace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* File layout - all values native endieness.
+ * The file header is followed by any number of entries.
+ * Must be consistant with asubExecReplay.py
+ */
+#define asubExecCaptureMagic    "asubCap1"
+#define asubExecCaptureVersion  1
+
+typedef struct asubExecCaptureHeader {
+   char magic [8];                     /* asubExecCaptureMagic, no null */
+   epicsUInt32 version;                /* asubExecCaptureVersion */
+   epicsUInt32 entrySize;              /* sizeof (asubExecCaptureEntry) */
+} asubExecCaptureHeader;
+
+/* Each entry is immediately followed by inputSize bytes of input frame and
+ * outputSize bytes of response.
+ */
+typedef struct asubExecCaptureEntry {
+   char record [64];                   /* record name, null terminated */
+   epicsUInt64 queued;                 /* nSec since 1970 */
+   epicsUInt64 latency;                /* nSec, queued to reaped */
+   epicsInt32 exitCode;
+   epicsUInt32 flags;                  /* asubExecTraceXxxx flags */
+   epicsUInt32 inputSize;
+   epicsUInt32 outputSize;
+} asubExecCaptureEntry;
+
+/* Is the named record currently selected for capture?
+ * The generation is the caller's cached capture generation, used together
+ * with selected to avoid re-matching the record name on every execution.
+ */
+bool asubExecCaptureSelected (const char* recordName, epicsUInt32* generation,
+                              bool* selected);
+
+/* Writes one captured execution. Thread safe.
+ */
+void asubExecCaptureWrite (const char* recordName, const asubExecTrace* trace,
+                           const void* input, const size_t inputSize,
+                           const void* output, const size_t outputSize);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_CAPTURE_H */
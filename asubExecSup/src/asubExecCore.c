@@ -0,0 +1,1742 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecCore.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * asubExec execution engine - see asubExecCore.h
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE                    /* pipe2 */
+#endif
+
+#include "asubExecCore.h"
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+extern char** environ;
+
+enum PipeIndex {
+   PIPE_READ = 0,
+   PIPE_WRITE,
+   PIPE_SIZE                      /* must be last */
+};
+
+typedef int HalfDuplexPipe[PIPE_SIZE];
+
+/* Maximum time (mSec) spent in poll, so that the running flag is checked often.
+ */
+#define POLL_PERIOD         5
+
+#define PERRORF(...) asubExecPerrorf (__FUNCTION__, __LINE__, __VA_ARGS__);
+
+
+/*------------------------------------------------------------------------------
+ */
+const char* asubExecStatusText (const asubExecStatus status)
+{
+   switch (status) {
+      case asubExecOkay:       return "okay";
+      case asubExecNoMemory:   return "no memory";
+      case asubExecBadStx:     return "stx invalid";
+      case asubExecBadVersion: return "version mis-match";
+      case asubExecBadType:    return "type invalid";
+      case asubExecTruncated:  return "truncated";
+      case asubExecBadEtx:     return "etx invalid";
+      case asubExecTimedOut:   return "timeout";
+      case asubExecAborted:    return "aborted";
+      case asubExecIoError:    return "i/o error";
+      case asubExecFailed:     return "request failed";
+   }
+   return "unknown";
+}
+
+/*------------------------------------------------------------------------------
+ * As per EPICS dbValueSize.
+ */
+size_t asubExecTypeSize (const asubExecDataType type)
+{
+   switch (type) {
+      case asubExecTypeSTRING: return asubExecStringSize;
+      case asubExecTypeCHAR:   return sizeof (int8_t);
+      case asubExecTypeUCHAR:  return sizeof (uint8_t);
+      case asubExecTypeSHORT:  return sizeof (int16_t);
+      case asubExecTypeUSHORT: return sizeof (uint16_t);
+      case asubExecTypeLONG:   return sizeof (int32_t);
+      case asubExecTypeULONG:  return sizeof (uint32_t);
+      case asubExecTypeFLOAT:  return sizeof (float);
+      case asubExecTypeDOUBLE: return sizeof (double);
+      case asubExecTypeENUM:   return sizeof (uint16_t);
+      case asubExecTypeINT64:  return sizeof (int64_t);
+      case asubExecTypeUINT64: return sizeof (uint64_t);
+      default:                 return 0;
+   }
+   return 0;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static const char* const typeNames [NUMBER_OF_FIELD_TYPES] = {
+   "STRING", "CHAR", "UCHAR", "SHORT", "USHORT", "LONG",
+   "ULONG", "FLOAT", "DOUBLE", "ENUM", "INT64", "UINT64"
+};
+
+const char* asubExecTypeName (const asubExecDataType type)
+{
+   if (type < 0 || type >= NUMBER_OF_FIELD_TYPES) return "NONE";
+   return typeNames [type];
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecDataType asubExecTypeFromName (const char* name)
+{
+   int j;
+
+   if (!name) return asubExecTypeNone;
+   for (j = 0; j < NUMBER_OF_FIELD_TYPES; j++) {
+      if (strcmp (name, typeNames [j]) == 0) return (asubExecDataType) j;
+   }
+   return asubExecTypeNone;
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecTypeIsNumeric (const asubExecDataType type)
+{
+   return (type > asubExecTypeSTRING) && (type < NUMBER_OF_FIELD_TYPES);
+}
+
+/*------------------------------------------------------------------------------
+ */
+const char* asubExecTimeOfDay (void)
+{
+   struct timeval theTime;           // essentially secs and usecs.
+   struct tm bt;                     // broken-down time
+
+   gettimeofday (&theTime, NULL);
+   localtime_r (&theTime.tv_sec, &bt);
+
+   static char buffer [24];
+
+   int mSec = theTime.tv_usec / 1000;
+   snprintf (buffer, sizeof (buffer), "%02d:%02d:%02d.%03d",
+             bt.tm_hour, bt.tm_min, bt.tm_sec, mSec);
+   return buffer;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecPerrorf (const char* function, const int line_no, const char* format, ...)
+{
+   static const char* red   = "\033[31;1m";
+   static const char* reset = "\033[00m";
+
+   char message1 [200];
+   char message2 [240];
+   va_list arguments;
+   va_start (arguments, format);
+   vsnprintf (message1, sizeof (message1), format, arguments);
+   va_end (arguments);
+   snprintf (message2, sizeof (message2), "%s asubExec::%s:%d %s%s%s",
+             asubExecTimeOfDay (), function, line_no, red, message1, reset);
+   perror (message2);
+}
+
+
+/*------------------------------------------------------------------------------
+ * Buffers
+ *------------------------------------------------------------------------------
+ */
+bool asubExecBufferReserve (asubExecBuffer* buffer, const size_t capacity)
+{
+   if (capacity <= buffer->capacity) return true;
+
+   size_t grow = buffer->capacity ? buffer->capacity : 4096;
+   while (grow < capacity) grow *= 2;
+
+   uint8_t* grown = (uint8_t*) realloc (buffer->data, grow);
+   if (!grown) return false;
+   buffer->data = grown;
+   buffer->capacity = grow;
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecBufferAppend (asubExecBuffer* buffer, const void* data, const size_t count)
+{
+   if (!asubExecBufferReserve (buffer, buffer->size + count)) return false;
+   if (count > 0) memcpy (buffer->data + buffer->size, data, count);
+   buffer->size += count;
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecBufferFree (asubExecBuffer* buffer)
+{
+   free (buffer->data);
+   buffer->data = NULL;
+   buffer->size = 0;
+   buffer->capacity = 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ * Blobs
+ *------------------------------------------------------------------------------
+ */
+asubExecBlob* asubExecBlobAdopt (asubExecBuffer* buffer)
+{
+   asubExecBlob* blob = (asubExecBlob*) malloc (sizeof (asubExecBlob));
+   if (!blob) return NULL;
+
+   blob->references = 1;
+   blob->size = buffer->size;
+   blob->data = buffer->data;
+
+   buffer->data = NULL;
+   buffer->size = 0;
+   buffer->capacity = 0;
+   return blob;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecBlob* asubExecBlobRetain (asubExecBlob* blob)
+{
+   __atomic_fetch_add (&blob->references, 1, __ATOMIC_RELAXED);
+   return blob;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecBlobRelease (asubExecBlob* blob)
+{
+   if (!blob) return;
+   if (__atomic_sub_fetch (&blob->references, 1, __ATOMIC_ACQ_REL) == 0) {
+      free (blob->data);
+      free (blob);
+   }
+}
+
+
+/*------------------------------------------------------------------------------
+ * Deadlines
+ *------------------------------------------------------------------------------
+ */
+uint64_t asubExecMonotonicNow (void)
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_MONOTONIC, &ts);
+   return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/*------------------------------------------------------------------------------
+ * The default timeout is ~100 years, so clamp rather than overflow.
+ */
+void asubExecDeadlineSet (asubExecDeadline* deadline, const double seconds)
+{
+   const double maxSeconds = 1.0e10;
+   const double s = seconds < 0.0 ? 0.0 : (seconds > maxSeconds ? maxSeconds : seconds);
+   deadline->end = asubExecMonotonicNow () + (uint64_t) (s * 1.0e9);
+}
+
+/*------------------------------------------------------------------------------
+ */
+double asubExecDeadlineRemaining (const asubExecDeadline* deadline)
+{
+   const uint64_t now = asubExecMonotonicNow ();
+   if (now >= deadline->end) return 0.0;
+   return (double) (deadline->end - now) * 1.0e-9;
+}
+
+/*------------------------------------------------------------------------------
+ * Waits up to POLL_PERIOD mSec, less if the deadline is sooner, for the file
+ * to become ready.
+ */
+static void pollWait (const int fd, const short events, const asubExecDeadline* deadline)
+{
+   struct pollfd pfd;
+   int timeout = POLL_PERIOD;
+
+   const double remaining = asubExecDeadlineRemaining (deadline);
+   if (remaining * 1000.0 < timeout) timeout = (int) (remaining * 1000.0) + 1;
+
+   pfd.fd = fd;
+   pfd.events = events;
+   pfd.revents = 0;
+   poll (&pfd, 1, timeout);
+}
+
+
+/*------------------------------------------------------------------------------
+ * Type conversion
+ *------------------------------------------------------------------------------
+ * Each (destination, source) pair has its own simple loop so that the compiler
+ * can vectorise it - these kernels are always compiled with vectorisation
+ * enabled, whatever the module's optimisation level.
+ * Conversion is a plain C cast as per EPICS dbConvert.
+ */
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize ("tree-vectorize")
+#endif
+
+#define CONVERT(dstT, srcT) {                                                  \
+   dstT* restrict d = (dstT*) dst;                                             \
+   const srcT* restrict s = (const srcT*) src;                                 \
+   size_t j;                                                                   \
+   for (j = 0; j < number; j++) d [j] = (dstT) s [j];                          \
+} break;
+
+#define CONVERT_TO(dstT)                                                       \
+static bool convertTo_##dstT (void* restrict dst,                              \
+                              const asubExecDataType srcType,                  \
+                              const void* restrict src,                        \
+                              const size_t number)                             \
+{                                                                              \
+   switch (srcType) {                                                          \
+      case asubExecTypeCHAR:   CONVERT (dstT, int8_t)                          \
+      case asubExecTypeUCHAR:  CONVERT (dstT, uint8_t)                         \
+      case asubExecTypeSHORT:  CONVERT (dstT, int16_t)                         \
+      case asubExecTypeUSHORT: CONVERT (dstT, uint16_t)                        \
+      case asubExecTypeLONG:   CONVERT (dstT, int32_t)                         \
+      case asubExecTypeULONG:  CONVERT (dstT, uint32_t)                        \
+      case asubExecTypeFLOAT:  CONVERT (dstT, float)                           \
+      case asubExecTypeDOUBLE: CONVERT (dstT, double)                          \
+      case asubExecTypeENUM:   CONVERT (dstT, uint16_t)                        \
+      case asubExecTypeINT64:  CONVERT (dstT, int64_t)                         \
+      case asubExecTypeUINT64: CONVERT (dstT, uint64_t)                        \
+      default: return false;                                                   \
+   }                                                                           \
+   return true;                                                                \
+}
+
+CONVERT_TO (int8_t)
+CONVERT_TO (uint8_t)
+CONVERT_TO (int16_t)
+CONVERT_TO (uint16_t)
+CONVERT_TO (int32_t)
+CONVERT_TO (uint32_t)
+CONVERT_TO (float)
+CONVERT_TO (double)
+CONVERT_TO (int64_t)
+CONVERT_TO (uint64_t)
+
+#undef CONVERT_TO
+#undef CONVERT
+
+/* Output transforms. Unused stages are made identities rather than tested
+ * within the loop. Note: dst may equal src.
+ * The DOUBLE kernel's counts need 64 bit integer compares, so it is only
+ * vectorised for targets that have them, e.g. -msse4.2 or -mavx2 on x86_64.
+ */
+#define TRANSFORM(T)                                                           \
+static void transform_##T (T* dst, const T* src, const size_t number,          \
+                           const asubExecTransform* t,                         \
+                           asubExecTransformCounts* counts)                    \
+{                                                                              \
+   const T k = t->scale ? (T) t->k : (T) 1;                                    \
+   const T o = t->scale ? (T) t->o : (T) 0;                                    \
+   const T lo = t->clamp ? (T) t->lo : (T) -HUGE_VAL;                          \
+   const T hi = t->clamp ? (T) t->hi : (T) HUGE_VAL;                           \
+   const T nanValue = t->nan ? (T) t->nanValue : (T) NAN;                      \
+   size_t clamped = 0;                                                         \
+   size_t nans = 0;                                                            \
+   size_t j;                                                                   \
+   for (j = 0; j < number; j++) {                                              \
+      const T y = src [j] * k + o;                                             \
+      const T c = y < lo ? lo : (y > hi ? hi : y);                             \
+      clamped += (y < lo) | (y > hi);                                          \
+      nans += (y != y);                                                        \
+      dst [j] = (y != y) ? nanValue : c;                                       \
+   }                                                                           \
+   counts->clamped += clamped;                                                 \
+   counts->nans += nans;                                                       \
+}
+
+TRANSFORM (float)
+TRANSFORM (double)
+
+#undef TRANSFORM
+
+/* Input slicing. Each kernel reduces number blocks of src, the first block
+ * starting at src [0], into dst. All blocks are step elements except the last,
+ * which is tail (1 .. step) elements. Acc is scratch space for number doubles.
+ * Blocks are reduced column wise, i.e. the k'th element of every block at a
+ * time, so that the loops over blocks vectorise without re-ordering any
+ * floating point arithmetic.
+ */
+#define SLICE(T)                                                               \
+static void slice_##T (T* restrict dst, const T* restrict src,                 \
+                       const size_t number, const size_t step,                 \
+                       const size_t tail, const asubExecReduce reduce,         \
+                       double* restrict acc)                                   \
+{                                                                              \
+   const size_t last = number - 1;                                             \
+   size_t j, k;                                                                \
+   switch (reduce) {                                                           \
+      case asubExecReduceMax:                                                  \
+         for (j = 0; j < number; j++) dst [j] = src [j * step];                \
+         for (k = 1; k < step; k++) {                                          \
+            for (j = 0; j < last; j++) {                                       \
+               const T x = src [j * step + k];                                 \
+               dst [j] = x > dst [j] ? x : dst [j];                            \
+            }                                                                  \
+         }                                                                     \
+         for (k = 1; k < tail; k++) {                                          \
+            const T x = src [last * step + k];                                 \
+            dst [last] = x > dst [last] ? x : dst [last];                      \
+         }                                                                     \
+         break;                                                                \
+      case asubExecReduceMean:                                                 \
+         for (j = 0; j < number; j++) acc [j] = (double) src [j * step];       \
+         for (k = 1; k < step; k++) {                                          \
+            for (j = 0; j < last; j++) acc [j] += (double) src [j * step + k]; \
+         }                                                                     \
+         for (k = 1; k < tail; k++) acc [last] += (double) src [last * step + k]; \
+         for (j = 0; j < last; j++) dst [j] = (T) (acc [j] / (double) step);   \
+         dst [last] = (T) (acc [last] / (double) tail);                        \
+         break;                                                                \
+      default:                                                                 \
+         for (j = 0; j < number; j++) dst [j] = src [j * step];                \
+         break;                                                                \
+   }                                                                           \
+}
+
+SLICE (int8_t)
+SLICE (uint8_t)
+SLICE (int16_t)
+SLICE (uint16_t)
+SLICE (int32_t)
+SLICE (uint32_t)
+SLICE (float)
+SLICE (double)
+SLICE (int64_t)
+SLICE (uint64_t)
+
+#undef SLICE
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecConvert (const asubExecDataType dstType, void* dst,
+                      const asubExecDataType srcType, const void* src,
+                      const size_t number)
+{
+   if (!asubExecTypeIsNumeric (srcType)) return false;
+
+   if (dstType == srcType) {
+      memcpy (dst, src, number * asubExecTypeSize (srcType));
+      return true;
+   }
+
+   switch (dstType) {
+      case asubExecTypeCHAR:   return convertTo_int8_t   (dst, srcType, src, number);
+      case asubExecTypeUCHAR:  return convertTo_uint8_t  (dst, srcType, src, number);
+      case asubExecTypeSHORT:  return convertTo_int16_t  (dst, srcType, src, number);
+      case asubExecTypeUSHORT: return convertTo_uint16_t (dst, srcType, src, number);
+      case asubExecTypeLONG:   return convertTo_int32_t  (dst, srcType, src, number);
+      case asubExecTypeULONG:  return convertTo_uint32_t (dst, srcType, src, number);
+      case asubExecTypeFLOAT:  return convertTo_float    (dst, srcType, src, number);
+      case asubExecTypeDOUBLE: return convertTo_double   (dst, srcType, src, number);
+      case asubExecTypeENUM:   return convertTo_uint16_t (dst, srcType, src, number);
+      case asubExecTypeINT64:  return convertTo_int64_t  (dst, srcType, src, number);
+      case asubExecTypeUINT64: return convertTo_uint64_t (dst, srcType, src, number);
+      default:                 return false;
+   }
+   return false;
+}
+
+/*------------------------------------------------------------------------------
+ * Frame data has no particular alignment, so unless suitably aligned, the
+ * source is converted via an aligned bounce buffer.
+ */
+static void convertFromFrame (const asubExecDataType dstType, void* dst,
+                              const asubExecDataType srcType, const uint8_t* src,
+                              const size_t number)
+{
+   const size_t srcSize = asubExecTypeSize (srcType);
+   const size_t dstSize = asubExecTypeSize (dstType);
+
+   if (((uintptr_t) src % srcSize) == 0) {
+      asubExecConvert (dstType, dst, srcType, src, number);
+      return;
+   }
+
+   double bounce [512];
+   const size_t chunk = sizeof (bounce) / srcSize;
+   size_t done = 0;
+
+   while (done < number) {
+      const size_t n = (number - done) < chunk ? (number - done) : chunk;
+      memcpy (bounce, src + done * srcSize, n * srcSize);
+      asubExecConvert (dstType, (uint8_t*) dst + done * dstSize, srcType, bounce, n);
+      done += n;
+   }
+}
+
+
+/*------------------------------------------------------------------------------
+ * Transforms number elements of type from src to dst, which may be the same.
+ * Only FLOAT and DOUBLE are transformed.
+ */
+static void transform (const asubExecDataType type, void* dst, const void* src,
+                       const size_t number, const asubExecTransform* t,
+                       asubExecTransformCounts* counts)
+{
+   switch (type) {
+      case asubExecTypeFLOAT:
+         transform_float ((float*) dst, (const float*) src, number, t, counts);
+         break;
+      case asubExecTypeDOUBLE:
+         transform_double ((double*) dst, (const double*) src, number, t, counts);
+         break;
+      default:
+         break;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * Slices number blocks of type from src into dst - see SLICE above.
+ * STRING elements may only be picked.
+ */
+static void sliceBlocks (const asubExecDataType type, void* dst, const void* src,
+                         const size_t number, const size_t step, const size_t tail,
+                         const asubExecReduce reduce, double* acc)
+{
+   size_t j;
+
+#define SLICE_AS(T) slice_##T ((T*) dst, (const T*) src, number, step, tail, reduce, acc)
+
+   switch (type) {
+      case asubExecTypeCHAR:   SLICE_AS (int8_t);   break;
+      case asubExecTypeUCHAR:  SLICE_AS (uint8_t);  break;
+      case asubExecTypeSHORT:  SLICE_AS (int16_t);  break;
+      case asubExecTypeUSHORT: SLICE_AS (uint16_t); break;
+      case asubExecTypeLONG:   SLICE_AS (int32_t);  break;
+      case asubExecTypeULONG:  SLICE_AS (uint32_t); break;
+      case asubExecTypeFLOAT:  SLICE_AS (float);    break;
+      case asubExecTypeDOUBLE: SLICE_AS (double);   break;
+      case asubExecTypeENUM:   SLICE_AS (uint16_t); break;
+      case asubExecTypeINT64:  SLICE_AS (int64_t);  break;
+      case asubExecTypeUINT64: SLICE_AS (uint64_t); break;
+      default:
+         for (j = 0; j < number; j++) {
+            memcpy ((uint8_t*) dst + j * asubExecStringSize,
+                    (const uint8_t*) src + j * step * asubExecStringSize,
+                    asubExecStringSize);
+         }
+         break;
+   }
+
+#undef SLICE_AS
+}
+
+/*------------------------------------------------------------------------------
+ * Parses one "name:a[,b]" transform stage, with end being the end of the stage.
+ */
+static bool parseStage (const char* stage, const char* end, asubExecTransform* t)
+{
+   const char* colon = memchr (stage, ':', end - stage);
+   double values [2];
+   int number = 0;
+   const char* p;
+
+   if (!colon) return false;
+   while (stage < colon && *stage == ' ') stage++;
+
+   for (p = colon + 1; p < end && number < 2; number++) {
+      char* next;
+      values [number] = strtod (p, &next);
+      if (next == p || next > end) return false;
+      while (next < end && *next == ' ') next++;
+      if (next < end && *next != ',') return false;
+      p = next < end ? next + 1 : next;
+   }
+   if (p < end) return false;   /* too many values */
+
+#define IS_STAGE(name) ((size_t) (colon - stage) == strlen (name) &&           \
+                        strncmp (stage, name, colon - stage) == 0)
+
+   if (IS_STAGE ("scale") && number == 2) {
+      t->scale = true;
+      t->k = values [0];
+      t->o = values [1];
+   } else if (IS_STAGE ("scale") && number == 1) {
+      t->scale = true;
+      t->k = values [0];
+      t->o = 0.0;
+   } else if (IS_STAGE ("clamp") && number == 2 && values [0] <= values [1]) {
+      t->clamp = true;
+      t->lo = values [0];
+      t->hi = values [1];
+   } else if (IS_STAGE ("nan") && number == 1) {
+      t->nan = true;
+      t->nanValue = values [0];
+   } else {
+      return false;
+   }
+
+#undef IS_STAGE
+
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecTransformParse (const char* spec, asubExecTransform* transform)
+{
+   asubExecTransform t;
+   const char* stage = spec;
+
+   memset (&t, 0, sizeof (t));
+
+   while (*stage) {
+      const char* end = strchr (stage, ';');
+      if (!end) end = stage + strlen (stage);
+      if (!parseStage (stage, end, &t)) return false;
+      stage = *end ? end + 1 : end;
+   }
+
+   if (!t.scale && !t.clamp && !t.nan) return false;
+
+   *transform = t;
+   return true;
+}
+
+
+/*------------------------------------------------------------------------------
+ * Parses an optional unsigned slice value, with end being the end of the value.
+ */
+static bool parseSliceValue (const char* p, const char* end, uint32_t* value)
+{
+   unsigned long long v = 0;
+
+   if (p == end) return true;   /* omitted - leave default */
+   for (; p < end; p++) {
+      if (*p < '0' || *p > '9') return false;
+      v = v * 10 + (unsigned) (*p - '0');
+      if (v > UINT32_MAX) return false;
+   }
+   *value = (uint32_t) v;
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecSliceParse (const char* spec, asubExecSlice* slice)
+{
+   asubExecSlice t;
+   const char* semi = strchr (spec, ';');
+   const char* end = semi ? semi : spec + strlen (spec);
+   const char* first = memchr (spec, ':', end - spec);
+   const char* second;
+
+   t.start = 0;
+   t.stop = UINT32_MAX;
+   t.step = 1;
+   t.reduce = asubExecReducePick;
+
+   if (!first) return false;
+   second = memchr (first + 1, ':', end - (first + 1));
+
+   if (!parseSliceValue (spec, first, &t.start)) return false;
+   if (second) {
+      if (!parseSliceValue (first + 1, second, &t.stop)) return false;
+      if (!parseSliceValue (second + 1, end, &t.step)) return false;
+   } else {
+      if (!parseSliceValue (first + 1, end, &t.stop)) return false;
+   }
+   if (t.step == 0 || t.start > t.stop) return false;
+
+   if (semi) {
+      if (strcmp (semi + 1, "mean") == 0) {
+         t.reduce = asubExecReduceMean;
+      } else if (strcmp (semi + 1, "max") == 0) {
+         t.reduce = asubExecReduceMax;
+      } else if (strcmp (semi + 1, "pick") != 0) {
+         return false;
+      }
+   }
+
+   *slice = t;
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+uint32_t asubExecSliceCount (const asubExecSlice* slice, const uint32_t number)
+{
+   const uint32_t end = slice->stop < number ? slice->stop : number;
+   if (slice->start >= end) return 0;
+   return (uint32_t) (((uint64_t) end - slice->start + slice->step - 1) / slice->step);
+}
+
+/*------------------------------------------------------------------------------
+ * And likewise, unless suitably aligned, the destination is converted via
+ * an aligned bounce buffer.
+ */
+static void convertToFrame (const asubExecDataType dstType, uint8_t* dst,
+                            const asubExecDataType srcType, const void* src,
+                            const size_t number)
+{
+   const size_t srcSize = asubExecTypeSize (srcType);
+   const size_t dstSize = asubExecTypeSize (dstType);
+
+   if (((uintptr_t) dst % dstSize) == 0) {
+      asubExecConvert (dstType, dst, srcType, src, number);
+      return;
+   }
+
+   double bounce [512];
+   const size_t chunk = sizeof (bounce) / dstSize;
+   size_t done = 0;
+
+   while (done < number) {
+      const size_t n = (number - done) < chunk ? (number - done) : chunk;
+      asubExecConvert (dstType, bounce, srcType, (const uint8_t*) src + done * srcSize, n);
+      memcpy (dst + done * dstSize, bounce, n * dstSize);
+      done += n;
+   }
+}
+
+
+/*------------------------------------------------------------------------------
+ * Frames
+ *------------------------------------------------------------------------------
+ */
+
+/*------------------------------------------------------------------------------
+ * The type an input is sent as.
+ */
+static asubExecDataType encodeType (const asubExecField* input,
+                                    const asubExecDataType encodeTypes[], const int j)
+{
+   if (encodeTypes && encodeTypes[j] != input->type &&
+       asubExecTypeIsNumeric (encodeTypes[j]) && asubExecTypeIsNumeric (input->type)) {
+      return encodeTypes[j];
+   }
+   return input->type;
+}
+
+/*------------------------------------------------------------------------------
+ * The number of elements an input is sent as.
+ */
+static uint32_t encodeNumber (const asubExecField* input,
+                              const asubExecSlice* const slices[], const int j)
+{
+   if (slices && slices[j]) return asubExecSliceCount (slices[j], input->number);
+   return input->number;
+}
+
+/*------------------------------------------------------------------------------
+ * Slices the input into the frame at p, number elements, converting to sendType
+ * if required. This is done in chunks small enough for the blocks being reduced
+ * to remain in cache.
+ */
+static void encodeSlice (uint8_t* p, const asubExecDataType sendType,
+                         const asubExecField* input, const asubExecSlice* slice,
+                         const uint32_t number)
+{
+   enum { chunk = 64 };
+   const size_t srcSize = asubExecTypeSize (input->type);
+   const size_t sendSize = asubExecTypeSize (sendType);
+   const size_t step = slice->step;
+   const uint32_t end = slice->stop < input->number ? slice->stop : input->number;
+   double bounce [512];    /* chunk elements of up to asubExecStringSize bytes */
+   double acc [chunk];
+   size_t done = 0;
+
+   while (done < number) {
+      const size_t n = (number - done) < chunk ? (number - done) : chunk;
+      const size_t first = slice->start + done * step;
+      const size_t tail = (done + n < number) ? step : end - (first + (n - 1) * step);
+
+      sliceBlocks (input->type, bounce, (const uint8_t*) input->data + first * srcSize,
+                   n, step, tail, slice->reduce, acc);
+
+      if (sendType == input->type) {
+         memcpy (p + done * sendSize, bounce, n * sendSize);
+      } else {
+         convertToFrame (sendType, p + done * sendSize, input->type, bounce, n);
+      }
+      done += n;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecEncodeWith (asubExecBuffer* frame, const bool counted,
+                                   const asubExecField inputs[],
+                                   const int numberInputs,
+                                   const asubExecDataType encodeTypes[],
+                                   const asubExecSlice* const slices[],
+                                   const asubExecField outputs[],
+                                   const int numberOutputs)
+{
+   const size_t stxLen = strlen (asubExecStx);
+   const size_t etxLen = strlen (asubExecEtx);
+   const size_t metaLen = sizeof (int16_t) + sizeof (uint32_t);
+   const uint32_t version = counted ? asubExecVersionCounted : asubExecVersion;
+   const uint32_t counts [2] = { numberInputs, numberOutputs };
+   size_t total;
+   uint8_t* p;
+   int j;
+
+   /* Size the whole frame first, so that at most one allocation is needed.
+    */
+   total = stxLen + sizeof (version) + etxLen + (numberInputs + numberOutputs) * metaLen;
+   if (counted) total += sizeof (counts);
+   for (j = 0; j < numberInputs; j++) {
+      const asubExecDataType type = encodeType (&inputs[j], encodeTypes, j);
+      total += (size_t) encodeNumber (&inputs[j], slices, j) * asubExecTypeSize (type);
+   }
+
+   frame->size = 0;
+   if (!asubExecBufferReserve (frame, total)) return asubExecNoMemory;
+
+   p = frame->data;
+
+   /* First house keeping - magic word and version.
+    */
+   memcpy (p, asubExecStx, stxLen);             p += stxLen;
+   memcpy (p, &version, sizeof (version));      p += sizeof (version);
+   if (counted) {
+      memcpy (p, counts, sizeof (counts));      p += sizeof (counts);
+   }
+
+   for (j = 0; j < numberInputs; j++) {
+      const asubExecDataType sendType = encodeType (&inputs[j], encodeTypes, j);
+      const int16_t type = sendType;
+      const uint32_t number = encodeNumber (&inputs[j], slices, j);
+      const size_t size = (size_t) number * asubExecTypeSize (sendType);
+
+      memcpy (p, &type, sizeof (type));         p += sizeof (type);
+      memcpy (p, &number, sizeof (number));     p += sizeof (number);
+      if (size > 0) {
+         if (slices && slices[j]) {
+            encodeSlice (p, sendType, &inputs[j], slices[j], number);
+         } else if (sendType == inputs[j].type) {
+            memcpy (p, inputs[j].data, size);
+         } else {
+            convertToFrame (sendType, p, inputs[j].type, inputs[j].data, number);
+         }
+      }
+      p += size;
+   }
+
+   /* And encode the expected output format.
+    * Like above, but no data - just type and number of elements.
+    */
+   for (j = 0; j < numberOutputs; j++) {
+      const int16_t type = outputs[j].type;
+      const uint32_t number = outputs[j].number;
+
+      memcpy (p, &type, sizeof (type));         p += sizeof (type);
+      memcpy (p, &number, sizeof (number));     p += sizeof (number);
+   }
+
+   /* And lastly terminate data stream.
+    */
+   memcpy (p, asubExecEtx, etxLen);             p += etxLen;
+
+   frame->size = p - frame->data;
+   return asubExecOkay;
+}
+
+/*------------------------------------------------------------------------------
+ * Checks the response stx and version, and determines the number of fields.
+ * On success, pos is set to the offset of the first field.
+ */
+static asubExecStatus readPrologue (const uint8_t* data, const size_t size,
+                                    const int numberFields,
+                                    size_t* pos, uint32_t* count)
+{
+   const size_t stxLen = strlen (asubExecStx);
+   const uint32_t mask = 0x00FFFF00;   /* skip minor version number */
+   uint32_t version;
+
+   if (memcmp (data, asubExecStx, size < stxLen ? size : stxLen) != 0) return asubExecBadStx;
+   *pos = stxLen;
+
+   if (size < *pos + sizeof (version)) return asubExecTruncated;
+   memcpy (&version, data + *pos, sizeof (version));
+   *pos += sizeof (version);
+
+   if ((version & mask) == (asubExecVersionCounted & mask)) {
+      if (size < *pos + sizeof (*count)) return asubExecTruncated;
+      memcpy (count, data + *pos, sizeof (*count));
+      *pos += sizeof (*count);
+      return asubExecOkay;
+   }
+
+   if ((version & mask) != (asubExecVersion & mask)) return asubExecBadVersion;
+
+   *count = numberFields;
+   return asubExecOkay;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecFrameLength (const uint8_t* data, const size_t size,
+                                    const int numberFields, size_t* length)
+{
+   const size_t etxLen = strlen (asubExecEtx);
+   asubExecStatus status;
+   uint32_t count;
+   uint32_t j;
+   size_t pos;
+
+   status = readPrologue (data, size, numberFields, &pos, &count);
+   if (status != asubExecOkay) return status;
+
+   for (j = 0; j < count; j++) {
+      int16_t type;
+      uint32_t number;
+
+      if (size < pos + sizeof (type) + sizeof (number)) return asubExecTruncated;
+      memcpy (&type, data + pos, sizeof (type));
+      pos += sizeof (type);
+      memcpy (&number, data + pos, sizeof (number));
+      pos += sizeof (number);
+
+      const size_t elementSize = asubExecTypeSize (type);
+      if (elementSize == 0) return asubExecBadType;
+
+      pos += (size_t) number * elementSize;
+   }
+
+   if (size < pos + etxLen) return asubExecTruncated;
+   if (memcmp (data + pos, asubExecEtx, etxLen) != 0) return asubExecBadEtx;
+
+   *length = pos + etxLen;
+   return asubExecOkay;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecDecodeWith (const uint8_t* data, const size_t size,
+                                   const asubExecField outputs[],
+                                   const int numberFields,
+                                   asubExecField received[],
+                                   const asubExecTransform* const transforms[],
+                                   asubExecTransformCounts counts[])
+{
+   asubExecStatus status;
+   uint32_t count;
+   uint32_t j;
+   size_t length;
+   size_t pos;
+
+   /* Validate the whole frame first - then we can decode without checks.
+    */
+   status = asubExecFrameLength (data, size, numberFields, &length);
+   if (status != asubExecOkay) return status;
+
+   readPrologue (data, size, numberFields, &pos, &count);
+
+   for (j = 0; j < count; j++) {
+      int16_t readType;
+      uint32_t readNumber;
+
+      memcpy (&readType, data + pos, sizeof (readType));
+      pos += sizeof (readType);
+      memcpy (&readNumber, data + pos, sizeof (readNumber));
+      pos += sizeof (readNumber);
+
+      const asubExecDataType type = (asubExecDataType) readType;
+      const size_t elementSize = asubExecTypeSize (type);
+
+      if (j >= (uint32_t) numberFields) {
+         /* Surplus field - discard */
+         pos += (size_t) readNumber * elementSize;
+         continue;
+      }
+
+      const asubExecField* output = &outputs[j];
+      const uint32_t less = readNumber <= output->number ? readNumber : output->number;
+
+      if (received) {
+         received[j].type = type;
+         received[j].number = readNumber;
+         received[j].data = (void*) (data + pos);
+      }
+
+      const asubExecTransform* t = transforms ? transforms[j] : NULL;
+
+      if (less > 0) {
+         if (type == output->type) {
+            /* We have a winner - types match, so element sizes match.
+             * When aligned, transform directly out of the frame.
+             */
+            if (t && ((uintptr_t) (data + pos) % elementSize) == 0) {
+               transform (type, output->data, data + pos, less, t, &counts[j]);
+               t = NULL;
+            } else {
+               memcpy (output->data, data + pos, (size_t) less * elementSize);
+            }
+         } else if (asubExecTypeIsNumeric (type) && asubExecTypeIsNumeric (output->type)) {
+            convertFromFrame (output->type, output->data, type, data + pos, less);
+         } else {
+            t = NULL;   /* string/number mis-match - discard */
+         }
+
+         if (t) transform (output->type, output->data, output->data, less, t, &counts[j]);
+      }
+
+      pos += (size_t) readNumber * elementSize;
+   }
+
+   /* Fields missing from a counted response.
+    */
+   for (; received && j < (uint32_t) numberFields; j++) {
+      received[j].type = asubExecTypeNone;
+      received[j].number = 0;
+      received[j].data = NULL;
+   }
+
+   return asubExecOkay;
+}
+
+
+/*------------------------------------------------------------------------------
+ * Child process
+ *------------------------------------------------------------------------------
+ * Perform and immediate process exit.
+ */
+static void childExit (const int status)
+{
+   /* Don't run our parent's atexit() handlers.
+    */
+   _exit (status);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static bool isExecutable (const char* path)
+{
+   struct stat info;
+   return stat (path, &info) == 0 && S_ISREG (info.st_mode) && access (path, X_OK) == 0;
+}
+
+/*------------------------------------------------------------------------------
+ * As per execvp, an empty PATH element is the current directory, and the
+ * default PATH is used if PATH is not set.
+ */
+bool asubExecResolve (const char* file, char* path, const size_t size)
+{
+   const char* search = getenv ("PATH");
+   const char* p;
+
+   if (!file || !*file) return false;
+
+   if (strchr (file, '/')) {
+      if ((size_t) snprintf (path, size, "%s", file) >= size) return false;
+      return isExecutable (path);
+   }
+
+   if (!search) search = "/bin:/usr/bin";
+
+   for (p = search;; ) {
+      const char* end = strchr (p, ':');
+      const int length = end ? (int) (end - p) : (int) strlen (p);
+      const int n = length > 0 ? snprintf (path, size, "%.*s/%s", length, p, file)
+                               : snprintf (path, size, "./%s", file);
+
+      if (n > 0 && (size_t) n < size && isExecutable (path)) return true;
+      if (!end) break;
+      p = end + 1;
+   }
+   return false;
+}
+
+/*------------------------------------------------------------------------------
+ * Pipes are created close on exec so that they do not leak into child
+ * processes concurrently created by other threads.
+ */
+static bool openPipe (HalfDuplexPipe pipeFds)
+{
+#ifdef __linux__
+   return pipe2 (pipeFds, O_CLOEXEC) == 0;
+#else
+   if (pipe (pipeFds) != 0) return false;
+   fcntl (pipeFds[PIPE_READ], F_SETFD, FD_CLOEXEC);
+   fcntl (pipeFds[PIPE_WRITE], F_SETFD, FD_CLOEXEC);
+   return true;
+#endif
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void closePipe (HalfDuplexPipe pipeFds)
+{
+   close (pipeFds[PIPE_READ]);
+   close (pipeFds[PIPE_WRITE]);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void setNonBlocking (const int fd)
+{
+   int flags = fcntl (fd, F_GETFL, 0);
+   flags |= O_NONBLOCK;
+   fcntl (fd, F_SETFL, flags);
+}
+
+/*------------------------------------------------------------------------------
+ * The fork () and execvp () backend.
+ */
+static pid_t forkChild (const char* const argv[],
+                        HalfDuplexPipe input_data, HalfDuplexPipe output_data,
+                        HalfDuplexPipe gate)
+{
+   pid_t pid = fork ();
+   if (pid < 0) {
+      /* We have had a forking error. */
+      PERRORF ("fork ()");
+      return pid;
+   }
+
+   if (pid > 0) return pid;   /* We are the parent */
+
+   /* We are the child.
+    */
+   sigset_t emptyMask;
+   int status;
+   int fd;
+   int maxfd;
+
+   /* Reset which signals are blocked. The child process inherites these
+    * from the EPICS IOC. We need a "clean" slate, in particular, so that
+    * the child process will respond to a SIGTERM signal.
+    * The child process is free to catch SIGTERM if needs be.
+    */
+   sigemptyset (&emptyMask);
+   status = sigprocmask (SIG_SETMASK, &emptyMask, NULL);
+   if (status != 0) {
+      PERRORF ("sigprocmask ()");
+      childExit (asubExecExitSetup);
+   }
+
+   /* Connect standard IO to the pipes.
+    * Duplicate file descriptors to standard in/out
+    */
+   fd = dup2 (input_data[PIPE_READ], STDIN_FILENO);
+   if (fd != STDIN_FILENO) {
+      PERRORF ("dup2 (stdin)");
+      childExit (asubExecExitSetup);
+   }
+
+   fd = dup2 (output_data[PIPE_WRITE], STDOUT_FILENO);
+   if (fd != STDOUT_FILENO) {
+      PERRORF ("dup2 (stdout)");
+      childExit (asubExecExitSetup);
+   }
+
+   /* from posix/osdProcess.c
+    * close all open files except for STDIO so they will not be inherited
+    * by the spawned process. This includes the unused pipe descriptors.
+    *
+    * We "know" standard file descriptors are 0, 1 and 2
+    */
+   maxfd = sysconf (_SC_OPEN_MAX);
+   for (fd = 3; fd <= maxfd; fd++) {
+      if (gate && fd == gate[PIPE_READ]) continue;
+      close (fd);
+   }
+
+   /* If gated, wait for the parent to close its end of the gate, i.e. until
+    * it has attached performance counters. This is only done once all other
+    * files are closed, so that we hold no other child's gate open meanwhile.
+    */
+   if (gate) {
+      char ignore;
+      while (read (gate[PIPE_READ], &ignore, 1) < 0 && errno == EINTR);
+      close (gate[PIPE_READ]);
+   }
+
+   /* Now exec to new process. Caste to get rid of that pesky warning.
+    */
+   status = execvp (argv[0], (char *const *) argv);
+
+   /* The exec call failed - it returned - this is unexpected.
+    */
+   PERRORF ("execvp (\"%s\", ...) -> %d", argv[0], status);
+   childExit (asubExecExitNoExec);    /** does not return - most important **/
+   return -1;
+}
+
+/*------------------------------------------------------------------------------
+ * The posix_spawnp () backend. This avoids copying the IOC's page tables and
+ * closing every possible file descriptor, which fork () does for each execution.
+ */
+static pid_t spawnChild (const char* const argv[],
+                         HalfDuplexPipe input_data, HalfDuplexPipe output_data)
+{
+   posix_spawn_file_actions_t actions;
+   posix_spawnattr_t attr;
+   sigset_t emptyMask;
+   pid_t pid = -1;
+   int status;
+
+   posix_spawn_file_actions_init (&actions);
+   posix_spawnattr_init (&attr);
+
+   /* See forkChild for why the signal mask is reset.
+    */
+   sigemptyset (&emptyMask);
+   posix_spawnattr_setsigmask (&attr, &emptyMask);
+   posix_spawnattr_setflags (&attr, POSIX_SPAWN_SETSIGMASK);
+
+   /* dup2 clears close on exec on the standard in/out descriptors, and all
+    * our pipe descriptors are close on exec.
+    */
+   posix_spawn_file_actions_adddup2 (&actions, input_data[PIPE_READ], STDIN_FILENO);
+   posix_spawn_file_actions_adddup2 (&actions, output_data[PIPE_WRITE], STDOUT_FILENO);
+
+#if defined(__GLIBC__) && defined(__GLIBC_PREREQ)
+#if __GLIBC_PREREQ(2, 34)
+   /* Also close any other files the IOC did not open close on exec.
+    */
+   posix_spawn_file_actions_addclosefrom_np (&actions, STDERR_FILENO + 1);
+#endif
+#endif
+
+   status = posix_spawnp (&pid, argv[0], &actions, &attr,
+                          (char *const *) argv, environ);
+   if (status != 0) {
+      errno = status;
+      PERRORF ("posix_spawnp (\"%s\", ...) -> %d", argv[0], status);
+      pid = -1;
+   }
+
+   posix_spawnattr_destroy (&attr);
+   posix_spawn_file_actions_destroy (&actions);
+   return pid;
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecChildStart (asubExecChild* child, const asubExecBackend backend,
+                         const char* const argv[])
+{
+   return asubExecChildStartPerf (child, backend, argv, NULL);
+}
+
+/*------------------------------------------------------------------------------
+ * NOTE: any child process std err output gets direted to the parent's stderr.
+ */
+bool asubExecChildStartPerf (asubExecChild* child, const asubExecBackend backend,
+                             const char* const argv[], asubExecPerf* perf)
+{
+   HalfDuplexPipe input_data;
+   HalfDuplexPipe output_data;
+   HalfDuplexPipe gate;
+   bool gated = false;
+   pid_t pid;
+
+   /* Ensure not erroneous
+    */
+   child->pid = -1;
+   child->fdput = -1;
+   child->fdget = -1;
+   child->exitCode = -1;
+   child->termIssued = false;
+   child->killIssued = false;
+
+   /* Create pipes to comunicate with child process.
+    */
+   if (!openPipe (input_data)) {
+      PERRORF ("pipe (input_data)");
+      return false;
+   }
+
+   if (!openPipe (output_data)) {
+      PERRORF ("pipe (output_data)");
+      closePipe (input_data);
+      return false;
+   }
+
+   if (perf) asubExecPerfInit (perf);
+
+   if (backend == asubExecBackendSpawn) {
+      /* The child has already called exec when posix_spawnp returns, so the
+       * counters can only start now.
+       */
+      pid = spawnChild (argv, input_data, output_data);
+      if (perf && pid > 0) asubExecPerfOpen (perf, pid, false);
+   } else {
+      /* A gate holds the child before exec until its counters are attached,
+       * so that the counts are of the executable only.
+       */
+      gated = perf && openPipe (gate);
+      pid = forkChild (argv, input_data, output_data, gated ? gate : NULL);
+      if (gated) {
+         if (pid > 0) asubExecPerfOpen (perf, pid, true);
+         closePipe (gate);
+      }
+   }
+
+   /* Close unused pipe ends - the child has its own copies.
+    */
+   close (input_data[PIPE_READ]);
+   close (output_data[PIPE_WRITE]);
+
+   if (pid < 0) {
+      close (input_data[PIPE_WRITE]);
+      close (output_data[PIPE_READ]);
+      return false;
+   }
+
+   child->pid = pid;
+   child->fdput = input_data[PIPE_WRITE];
+   child->fdget = output_data[PIPE_READ];
+
+   /* Set put/get files non blocking - we need to be able to kill the
+    * child process if it exceeds allowed time and/or monitor shutdown requests.
+    */
+   setNonBlocking (child->fdput);
+   setNonBlocking (child->fdget);
+
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ * Writes all of count bytes to the child process.
+ */
+static asubExecStatus writeAll (asubExecChild* child,
+                                const void* data, const size_t count,
+                                const asubExecDeadline* deadline,
+                                const volatile bool* running)
+{
+   const uint8_t* buffer = (const uint8_t*) data;
+   asubExecStatus status = asubExecOkay;
+   size_t total = 0;
+
+   while (total < count) {
+      if (running && !*running) {
+         status = asubExecAborted;
+         break;
+      }
+
+      if (asubExecDeadlineRemaining (deadline) <= 0.0) {
+         status = asubExecTimedOut;
+         break;
+      }
+
+      const ssize_t numBytes = write (child->fdput, buffer + total, count - total);
+      if (numBytes >= 0) {
+         total += numBytes;
+         continue;
+      }
+
+      const int theError = errno;
+      if (theError == EINTR) continue;
+      if ((theError != EAGAIN) && (theError != EWOULDBLOCK)) {
+         /* This is an actual error
+          */
+         PERRORF ("write (,, %d)", (int) (count - total));
+         status = asubExecIoError;
+         break;
+      }
+
+      pollWait (child->fdput, POLLOUT, deadline);
+   }
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecChildWrite (asubExecChild* child,
+                                   const void* data, const size_t count,
+                                   const asubExecDeadline* deadline,
+                                   const volatile bool* running)
+{
+   const asubExecStatus status = writeAll (child, data, count, deadline, running);
+
+   if (close (child->fdput) != 0) {
+      PERRORF ("close (input_data [out])");
+   }
+   child->fdput = -1;
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ * A failure frame is just stx, version and etx.
+ */
+static bool isFailureFrame (const uint8_t* data, const size_t size)
+{
+   const size_t stxLen = strlen (asubExecStx);
+   const size_t etxLen = strlen (asubExecEtx);
+   const size_t etxPos = stxLen + sizeof (uint32_t);
+
+   return (size >= etxPos + etxLen) &&
+          (memcmp (data, asubExecStx, stxLen) == 0) &&
+          (memcmp (data + etxPos, asubExecEtx, etxLen) == 0);
+}
+
+/*------------------------------------------------------------------------------
+ * Reads into response, which is first cleared, until a complete frame starting
+ * at offset has been received, or end of file.
+ */
+static asubExecStatus readFrame (asubExecChild* child,
+                                 asubExecBuffer* response,
+                                 const size_t offset,
+                                 const int numberFields,
+                                 const asubExecDeadline* deadline,
+                                 const volatile bool* running)
+{
+   asubExecStatus status = asubExecTruncated;
+   size_t length;
+
+   response->size = 0;
+
+   while (true) {
+      if (running && !*running) {
+         status = asubExecAborted;
+         break;
+      }
+
+      if (asubExecDeadlineRemaining (deadline) <= 0.0) {
+         status = asubExecTimedOut;
+         break;
+      }
+
+      if (response->capacity - response->size < 4096 &&
+          !asubExecBufferReserve (response, response->size + 4096)) {
+         status = asubExecNoMemory;
+         break;
+      }
+
+      const ssize_t numBytes = read (child->fdget, response->data + response->size,
+                                     response->capacity - response->size);
+      if (numBytes > 0) {
+         response->size += numBytes;
+         if (response->size < offset) continue;
+
+         /* Stop as soon as we have a complete frame (or a broken one).
+          */
+         const uint8_t* frame = response->data + offset;
+         const size_t frameSize = response->size - offset;
+
+         if (offset > 0 && isFailureFrame (frame, frameSize)) {
+            status = asubExecFailed;
+            break;
+         }
+
+         status = asubExecFrameLength (frame, frameSize, numberFields, &length);
+         if (status != asubExecTruncated) break;
+         continue;
+      }
+
+      if (numBytes == 0) {
+         /* End of input - status remains as per last frame check.
+          */
+         break;
+      }
+
+      const int theError = errno;
+      if (theError == EINTR) continue;
+      if ((theError != EAGAIN) && (theError != EWOULDBLOCK)) {
+         /* This is an actual error
+          */
+         PERRORF ("read ()");
+         status = asubExecIoError;
+         break;
+      }
+
+      pollWait (child->fdget, POLLIN, deadline);
+   }
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecChildRead (asubExecChild* child,
+                                  asubExecBuffer* response,
+                                  const int numberFields,
+                                  const asubExecDeadline* deadline,
+                                  const volatile bool* running)
+{
+   const asubExecStatus status = readFrame (child, response, 0, numberFields,
+                                            deadline, running);
+
+   if (close (child->fdget) != 0) {
+      PERRORF ("close (output_data [in])");
+   }
+   child->fdget = -1;
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecChildSend (asubExecChild* child, const uint32_t tag,
+                                  const void* frame, const size_t count,
+                                  const asubExecDeadline* deadline,
+                                  const volatile bool* running)
+{
+   asubExecStatus status;
+
+   status = writeAll (child, &tag, sizeof (tag), deadline, running);
+   if (status != asubExecOkay) return status;
+
+   return writeAll (child, frame, count, deadline, running);
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecChildSendReady (asubExecChild* child, const uint32_t tag,
+                                       const asubExecDeadline* deadline,
+                                       const volatile bool* running)
+{
+   const size_t stxLen = strlen (asubExecStx);
+   const size_t etxLen = strlen (asubExecEtx);
+   const uint32_t version = asubExecVersionCounted;
+   const uint32_t counts [2] = { 0, 0 };
+   uint8_t frame [32];
+   uint8_t* p = frame;
+
+   memcpy (p, asubExecStx, stxLen);             p += stxLen;
+   memcpy (p, &version, sizeof (version));      p += sizeof (version);
+   memcpy (p, counts, sizeof (counts));         p += sizeof (counts);
+   memcpy (p, asubExecEtx, etxLen);             p += etxLen;
+
+   return asubExecChildSend (child, tag, frame, (size_t) (p - frame), deadline, running);
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecChildReceive (asubExecChild* child, uint32_t* tag,
+                                     asubExecBuffer* response,
+                                     const int numberFields,
+                                     const asubExecDeadline* deadline,
+                                     const volatile bool* running)
+{
+   const asubExecStatus status = readFrame (child, response, sizeof (*tag), numberFields,
+                                            deadline, running);
+
+   if (response->size >= sizeof (*tag)) {
+      /* Remove the tag, leaving just the frame.
+       */
+      memcpy (tag, response->data, sizeof (*tag));
+      response->size -= sizeof (*tag);
+      memmove (response->data, response->data + sizeof (*tag), response->size);
+   }
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecChildClose (asubExecChild* child)
+{
+   if (child->fdput >= 0 && close (child->fdput) != 0) {
+      PERRORF ("close (input_data [out])");
+   }
+   child->fdput = -1;
+
+   if (child->fdget >= 0 && close (child->fdget) != 0) {
+      PERRORF ("close (output_data [in])");
+   }
+   child->fdget = -1;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecChildReap (asubExecChild* child,
+                        const double termDelay, const double killDelay,
+                        const volatile bool* running)
+{
+   const uint64_t start = asubExecMonotonicNow ();
+   const uint64_t termTime = start + (uint64_t) (termDelay * 1.0e9);
+   const uint64_t killTime = start + (uint64_t) (killDelay * 1.0e9);
+   long sleepTime = 100000;     /* nSec - back off to 5 mSec */
+
+   if (child->pid <= 0) return;
+
+   /* Monitor the child process
+    */
+   while (!running || *running) {
+      int status = 0;
+
+      /* Wait for process to change state.
+       */
+      const pid_t pid = waitpid (child->pid, &status, WNOHANG);
+
+      if (pid == child->pid) {
+         /* Child process is complete - simple.
+          */
+         child->exitCode = WEXITSTATUS (status);
+         break;
+      }
+
+      if (pid != 0) {
+         /* an unexpected return value occured, either an error or another pid.
+          */
+         if (pid < 0 && errno == EINTR) continue;
+         PERRORF ("waitpid (%d) => %d, status = %d", child->pid, pid, status);
+         child->exitCode = asubExecExitWaitpid;
+         break;
+      }
+
+      /* pid == 0 - still waiting for child process to complete.
+       * Has the allowed time expired ?
+       */
+      const uint64_t timeNow = asubExecMonotonicNow ();
+
+      if (timeNow >= termTime && !child->termIssued) {
+         /* First ask nicely, then allow a while for orderly shutdown.
+          */
+         kill (child->pid, SIGTERM);
+         child->termIssued = true;
+         child->exitCode = asubExecExitTimeout;
+
+      } else if (timeNow >= killTime) {
+         /* No more Mr. Nice Guy ...
+          */
+         kill (child->pid, SIGKILL);
+         waitpid (child->pid, &status, 0);
+         child->killIssued = true;
+         child->exitCode = asubExecExitTimeout;
+         break;
+      }
+
+      struct timespec delay = { 0, sleepTime };
+      nanosleep (&delay, NULL);
+      sleepTime = sleepTime < 2500000 ? 2 * sleepTime : 5000000;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecChildPoll (asubExecChild* child)
+{
+   int status = 0;
+   pid_t pid;
+
+   if (child->pid <= 0) return true;
+
+   do {
+      pid = waitpid (child->pid, &status, WNOHANG);
+   } while (pid < 0 && errno == EINTR);
+
+   if (pid == 0) return false;
+
+   if (pid == child->pid) {
+      child->exitCode = WEXITSTATUS (status);
+   } else {
+      PERRORF ("waitpid (%d) => %d", child->pid, pid);
+      child->exitCode = asubExecExitWaitpid;
+   }
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+size_t asubExecChildDrain (asubExecChild* child)
+{
+   uint8_t discard [4096];
+   size_t total = 0;
+
+   while (child->fdget >= 0) {
+      const ssize_t n = read (child->fdget, discard, sizeof (discard));
+
+      if (n > 0) {
+         total += (size_t) n;
+      } else if (n < 0 && errno == EINTR) {
+         continue;
+      } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+         break;
+      } else {
+         /* End of file or error - either way we are done with stdout.
+          */
+         if (close (child->fdget) != 0) {
+            PERRORF ("close (output_data [in])");
+         }
+         child->fdget = -1;
+      }
+   }
+
+   return total;
+}
+
+/*------------------------------------------------------------------------------
+ * statm is the cheapest source - the second field is the resident pages.
+ */
+bool asubExecChildRss (const asubExecChild* child, uint64_t* bytes)
+{
+#ifdef __linux__
+   char filename [40];
+   unsigned long long size = 0;
+   unsigned long long resident = 0;
+   FILE* file;
+   int n;
+
+   if (child->pid <= 0) return false;
+
+   snprintf (filename, sizeof (filename), "/proc/%d/statm", (int) child->pid);
+   file = fopen (filename, "r");
+   if (!file) return false;
+   n = fscanf (file, "%llu %llu", &size, &resident);
+   fclose (file);
+   if (n != 2) return false;
+
+   *bytes = (uint64_t) resident * (uint64_t) sysconf (_SC_PAGESIZE);
+   return true;
+#else
+   return false;
+#endif
+}
+
+/* end */
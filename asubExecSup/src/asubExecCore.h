@@ -0,0 +1,369 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecCore.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * The asubExec execution engine: frame encode/decode, type conversion,
+ * child process creation and pipe I/O with deadlines.
+ *
+ * This is plain C (C99 + POSIX) and is independent of EPICS, so that it may be
+ * exercised and benchmarked without an IOC - see asubExecBench.c.
+ * The aSub record glue lives in asubExec.c.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_CORE_H
+#define ASUB_EXEC_CORE_H 1
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+#include "asubExec.h"
+#include "asubExecPerf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Normal exit codes are in range 0 to 127
+ * These are special case error pseudo exit codes
+ */
+#define asubExecExitBase       128
+#define asubExecExitSetup      (asubExecExitBase + 0)
+#define asubExecExitNoExec     (asubExecExitBase + 1)
+#define asubExecExitTimeout    (asubExecExitBase + 2)
+#define asubExecExitWaitpid    (asubExecExitBase + 3)
+
+/* Size of an encoded STRING element.
+ */
+#define asubExecStringSize     40
+
+/* Core function status values.
+ */
+typedef enum asubExecStatus {
+   asubExecOkay = 0,
+   asubExecNoMemory,                   /* buffer allocation failed */
+   asubExecBadStx,                     /* frame does not start with asubExecStx */
+   asubExecBadVersion,                 /* incompatible frame version */
+   asubExecBadType,                    /* unknown field type */
+   asubExecTruncated,                  /* frame incomplete */
+   asubExecBadEtx,                     /* frame does not end with asubExecEtx */
+   asubExecTimedOut,                   /* deadline expired */
+   asubExecAborted,                    /* running flag cleared */
+   asubExecIoError,                    /* read/write/system call failure, see errno */
+   asubExecFailed                      /* worker responded with a failure frame */
+} asubExecStatus;
+
+/* Describes one field (A .. U or VALA .. VALU).
+ * For encoded inputs, number is the number of elements available; for decoded
+ * outputs, number is the number of elements that data can hold.
+ */
+typedef struct asubExecField {
+   asubExecDataType type;
+   uint32_t number;
+   void* data;
+} asubExecField;
+
+/* How each selected block of step elements is reduced to one element.
+ */
+typedef enum asubExecReduce {
+   asubExecReducePick = 0,             /* first element of each block */
+   asubExecReduceMean,                 /* block mean - numeric only */
+   asubExecReduceMax                   /* block maximum - numeric only */
+} asubExecReduce;
+
+/* Input pre processing: elements start up to (but excluding) stop, in blocks of
+ * step elements, each block being reduced to one element. Stop is limited to
+ * the number of elements available, and the last block may be partial.
+ */
+typedef struct asubExecSlice {
+   uint32_t start;
+   uint32_t stop;
+   uint32_t step;
+   asubExecReduce reduce;
+} asubExecSlice;
+
+/* Output post processing, applied to FLOAT and DOUBLE outputs as they are
+ * decoded. Whatever the order specified, the value is scaled (k * x + o), then
+ * clamped to [lo, hi], and lastly NaNs are replaced by nanValue.
+ */
+typedef struct asubExecTransform {
+   bool scale;
+   double k, o;
+   bool clamp;
+   double lo, hi;
+   bool nan;
+   double nanValue;
+} asubExecTransform;
+
+/* Number of elements clamped, and number of NaN elements, by a transform.
+ */
+typedef struct asubExecTransformCounts {
+   uint64_t clamped;
+   uint64_t nans;
+} asubExecTransformCounts;
+
+/* Growable byte buffer - intended to be retained between executions so that,
+ * once grown, no further allocation is required.
+ */
+typedef struct asubExecBuffer {
+   uint8_t* data;
+   size_t size;                        /* bytes in use */
+   size_t capacity;                    /* bytes allocated */
+} asubExecBuffer;
+
+/* Immutable reference counted bytes, shared by any number of consumers, and
+ * freed when the last reference is released.
+ */
+typedef struct asubExecBlob {
+   int references;                     /* atomic */
+   size_t size;
+   uint8_t* data;
+} asubExecBlob;
+
+/* Absolute deadline on the monotonic clock.
+ */
+typedef struct asubExecDeadline {
+   uint64_t end;                       /* nSec */
+} asubExecDeadline;
+
+/* How the child process is created.
+ */
+typedef enum asubExecBackend {
+   asubExecBackendFork = 0,            /* fork () and execvp () */
+   asubExecBackendSpawn                /* posix_spawnp () */
+} asubExecBackend;
+
+/* Child process state.
+ */
+typedef struct asubExecChild {
+   pid_t pid;                          /* child process' pid, -1 if none */
+   int fdput;                          /* child process stdin  - we write to it */
+   int fdget;                          /* child process stdout - we read from it */
+   int exitCode;                       /* child process' (pseudo) exit code */
+   bool termIssued;                    /* SIGTERM sent whilst reaping */
+   bool killIssued;                    /* SIGKILL sent whilst reaping */
+} asubExecChild;
+
+
+/* Status and element size (encoded bytes per element) of each type.
+ * Element size is 0 for an invalid type.
+ */
+const char* asubExecStatusText (const asubExecStatus status);
+size_t asubExecTypeSize (const asubExecDataType type);
+bool asubExecTypeIsNumeric (const asubExecDataType type);
+
+/* Type names are as per menuFtype, e.g. "DOUBLE".
+ * asubExecTypeFromName returns asubExecTypeNone if the name is unknown.
+ */
+const char* asubExecTypeName (const asubExecDataType type);
+asubExecDataType asubExecTypeFromName (const char* name);
+
+/* Time of day as hh:mm:ss.mmm for diagnostics - not thread safe.
+ * asubExecPerrorf extends perror to be like printf.
+ */
+const char* asubExecTimeOfDay (void);
+void asubExecPerrorf (const char* function, const int line_no, const char* format, ...);
+
+/* Buffers. Append returns true if and only if successfull.
+ */
+bool asubExecBufferReserve (asubExecBuffer* buffer, const size_t capacity);
+bool asubExecBufferAppend (asubExecBuffer* buffer, const void* data, const size_t count);
+void asubExecBufferFree (asubExecBuffer* buffer);
+
+/* Blobs. Adopt creates a blob, with one reference, that takes over the buffer's
+ * data without copying, leaving the buffer empty. Returns NULL if out of memory,
+ * in which case the buffer is unchanged. Release accepts NULL.
+ */
+asubExecBlob* asubExecBlobAdopt (asubExecBuffer* buffer);
+asubExecBlob* asubExecBlobRetain (asubExecBlob* blob);
+void asubExecBlobRelease (asubExecBlob* blob);
+
+/* Deadlines. The monotonic time is in nSec.
+ */
+uint64_t asubExecMonotonicNow (void);
+void asubExecDeadlineSet (asubExecDeadline* deadline, const double seconds);
+double asubExecDeadlineRemaining (const asubExecDeadline* deadline);
+
+/* Converts number elements from src to dst. Both types must be numeric.
+ * Returns false if not convertable.
+ */
+bool asubExecConvert (const asubExecDataType dstType, void* dst,
+                      const asubExecDataType srcType, const void* src,
+                      const size_t number);
+
+/* Encodes the inputs and the expected output format into frame, which is
+ * first cleared. If counted, a version 1.3 counted frame with any number of
+ * inputs and outputs is created, otherwise a version 1.2 frame, in which case
+ * numberInputs and numberOutputs must both be the number of fields.
+ * Numeric input j is converted to and sent as encodeTypes[j], unless that is
+ * asubExecTypeNone, and sliced and reduced by slices[j], unless that is NULL,
+ * as it is encoded. The encoded number of elements is that after reduction.
+ * encodeTypes and slices may be NULL.
+ */
+asubExecStatus asubExecEncodeWith (asubExecBuffer* frame, const bool counted,
+                                   const asubExecField inputs[],
+                                   const int numberInputs,
+                                   const asubExecDataType encodeTypes[],
+                                   const asubExecSlice* const slices[],
+                                   const asubExecField outputs[],
+                                   const int numberOutputs);
+
+/* Parses a slice specification "start:stop:step", optionally followed by
+ * ";mean" or ";max", e.g. "100:2100:4;mean". Each of start, stop and step may
+ * be omitted, defaulting to the first element, all elements and 1.
+ * Returns true if and only if valid.
+ */
+bool asubExecSliceParse (const char* spec, asubExecSlice* slice);
+
+/* The number of elements remaining after slicing number elements.
+ */
+uint32_t asubExecSliceCount (const asubExecSlice* slice, const uint32_t number);
+
+/* Determines the length of the response frame in data.
+ * Version 1.2 responses contain numberFields fields, and version 1.3 (counted)
+ * responses the number of fields they specify.
+ * Returns asubExecOkay and sets length when complete, asubExecTruncated when
+ * more data is required, or other error status.
+ */
+asubExecStatus asubExecFrameLength (const uint8_t* data, const size_t size,
+                                    const int numberFields, size_t* length);
+
+/* Decodes the response frame into the outputs. Elements beyond those provided
+ * are left undefined, additional elements are discarded, and numeric type
+ * mis-matches are converted. Received, if not NULL, is set to the type and
+ * number of elements actually received for each field, and data pointing into
+ * the frame. FLOAT and DOUBLE output j is also transformed by transforms[j],
+ * unless that is NULL, during the copy out of the frame, and counts[j] updated
+ * accordingly. Transforms (and then counts) may be NULL.
+ */
+asubExecStatus asubExecDecodeWith (const uint8_t* data, const size_t size,
+                                   const asubExecField outputs[],
+                                   const int numberFields,
+                                   asubExecField received[],
+                                   const asubExecTransform* const transforms[],
+                                   asubExecTransformCounts counts[]);
+
+/* Parses a transform specification, e.g. "clamp:0,10;nan:0;scale:2.5,-1".
+ * Returns true if and only if valid.
+ */
+bool asubExecTransformParse (const char* spec, asubExecTransform* transform);
+
+/* Resolves file to the executable that execvp would run, i.e. searching PATH
+ * unless file contains a '/', into path. Returns true if and only if found.
+ */
+bool asubExecResolve (const char* file, char* path, const size_t size);
+
+/* Creates and starts the child process, with argv[0] as the file to execute.
+ * The pipe file descriptors are set non blocking.
+ * Returns true if and only if successfull.
+ */
+bool asubExecChildStart (asubExecChild* child, const asubExecBackend backend,
+                         const char* const argv[]);
+
+/* As asubExecChildStart, but also attaches perf counters to the child process
+ * unless perf is NULL. Counters that cannot be opened are left not open.
+ */
+bool asubExecChildStartPerf (asubExecChild* child, const asubExecBackend backend,
+                             const char* const argv[], asubExecPerf* perf);
+
+/* Writes all of count bytes to the child process and closes its stdin.
+ * Running, if not NULL, is polled and the write aborted if it becomes false.
+ */
+asubExecStatus asubExecChildWrite (asubExecChild* child,
+                                   const void* data, const size_t count,
+                                   const asubExecDeadline* deadline,
+                                   const volatile bool* running);
+
+/* Reads the response into response, which is first cleared, until a complete
+ * frame has been received or end of file, and closes the child's stdout.
+ */
+asubExecStatus asubExecChildRead (asubExecChild* child,
+                                  asubExecBuffer* response,
+                                  const int numberFields,
+                                  const asubExecDeadline* deadline,
+                                  const volatile bool* running);
+
+/* Persistent workers - the child process is not closed after each request.
+ * Send writes the tag (epicsUInt32) followed by count bytes of frame.
+ * Receive reads the tag and response frame into response, which is first
+ * cleared, and returns asubExecFailed if the worker sent a failure frame (stx,
+ * version and etx only). Only one request may be outstanding at a time.
+ */
+asubExecStatus asubExecChildSend (asubExecChild* child, const uint32_t tag,
+                                  const void* frame, const size_t count,
+                                  const asubExecDeadline* deadline,
+                                  const volatile bool* running);
+
+asubExecStatus asubExecChildReceive (asubExecChild* child, uint32_t* tag,
+                                     asubExecBuffer* response,
+                                     const int numberFields,
+                                     const asubExecDeadline* deadline,
+                                     const volatile bool* running);
+
+/* Persistent workers - sends a ready probe, i.e. the tag followed by an empty
+ * counted frame (no inputs or outputs), which the worker answers once it is able
+ * to serve requests. The response may be discarded using asubExecChildDrain.
+ */
+asubExecStatus asubExecChildSendReady (asubExecChild* child, const uint32_t tag,
+                                       const asubExecDeadline* deadline,
+                                       const volatile bool* running);
+
+/* Closes the child's stdin/stdout, if not already closed.
+ */
+void asubExecChildClose (asubExecChild* child);
+
+/* Waits for the child process to exit and sets exitCode. If it has not exited
+ * after termDelay seconds SIGTERM is sent, and if still running after
+ * killDelay seconds, SIGKILL. The exit code is the child's own exit status,
+ * even if it exits after SIGTERM, and asubExecExitTimeout if it is killed.
+ */
+void asubExecChildReap (asubExecChild* child,
+                        const double termDelay, const double killDelay,
+                        const volatile bool* running);
+
+/* Non blocking - returns true, having set exitCode, if the child process has
+ * exited (or cannot be waited for).
+ */
+bool asubExecChildPoll (asubExecChild* child);
+
+/* Non blocking - reads and discards whatever output the child process has
+ * written, closing stdout at end of file. Returns the number of bytes discarded.
+ */
+size_t asubExecChildDrain (asubExecChild* child);
+
+/* Gets the child process' resident set size in bytes, from /proc (Linux only).
+ * Returns true if and only if successfull.
+ */
+bool asubExecChildRss (const asubExecChild* child, uint64_t* bytes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_CORE_H */
@@ -0,0 +1,186 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecFlight.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * The asubExec flight recorder - see asubExecFlight.h
+ *
+ * Each execution claims a ticket by atomically incrementing the header's
+ * next field; the ticket modulo the slot count identifies the slot. The slot's
+ * sequence is cleared, the slot filled in and then the sequence set, so a
+ * reader (or post-mortem decoder) can discard partially written slots.
+ * No locks are taken, and no system calls are made when recording.
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include "asubExecFlight.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <epicsExport.h>
+#include <errlog.h>
+#include <iocsh.h>
+
+#define DEFAULT_SLOT_COUNT  4096
+
+static asubExecFlightHeader* flightHeader = NULL;
+static asubExecFlightSlot* flightSlots = NULL;
+
+
+/*------------------------------------------------------------------------------
+ */
+int asubExecFlightOpen (const char* filename, const int slotCount)
+{
+   int count = slotCount > 0 ? slotCount : DEFAULT_SLOT_COUNT;
+   size_t size;
+   void* map;
+   int fd;
+
+   if (!filename || !filename[0]) {
+      errlogPrintf ("asubExecFlightOpen: no filename specified\n");
+      return -1;
+   }
+
+   if (flightHeader) {
+      errlogPrintf ("asubExecFlightOpen: flight recorder already open\n");
+      return -1;
+   }
+
+   /* Preserve the previous file (if any) for post-mortem analysis.
+    */
+   if (access (filename, F_OK) == 0) {
+      char previous [256];
+      snprintf (previous, sizeof (previous), "%s.prev", filename);
+      if (rename (filename, previous) != 0) {
+         errlogPrintf ("asubExecFlightOpen: rename (%s, %s) failed: %s\n",
+                       filename, previous, strerror (errno));
+      }
+   }
+
+   size = sizeof (asubExecFlightHeader) + (size_t) count * sizeof (asubExecFlightSlot);
+
+   fd = open (filename, O_RDWR | O_CREAT | O_TRUNC, 0644);
+   if (fd < 0) {
+      errlogPrintf ("asubExecFlightOpen: open (%s) failed: %s\n", filename, strerror (errno));
+      return -1;
+   }
+
+   if (ftruncate (fd, (off_t) size) != 0) {
+      errlogPrintf ("asubExecFlightOpen: ftruncate (%s) failed: %s\n",
+                    filename, strerror (errno));
+      close (fd);
+      return -1;
+   }
+
+   map = mmap (NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close (fd);                  /* the mapping remains valid */
+   if (map == MAP_FAILED) {
+      errlogPrintf ("asubExecFlightOpen: mmap (%s) failed: %s\n", filename, strerror (errno));
+      return -1;
+   }
+
+   asubExecFlightHeader* header = (asubExecFlightHeader*) map;
+   memset (header, 0, sizeof (asubExecFlightHeader));
+   header->version = asubExecFlightVersion;
+   header->headerSize = sizeof (asubExecFlightHeader);
+   header->slotSize = sizeof (asubExecFlightSlot);
+   header->slotCount = count;
+   header->next = 0;
+   header->created = asubExecTraceNow ();
+   header->iocPid = getpid ();
+
+   /* Magic last - a decoder ignores files without it.
+    */
+   memcpy (header->magic, asubExecFlightMagic, sizeof (header->magic));
+
+   flightSlots = (asubExecFlightSlot*) ((char*) map + sizeof (asubExecFlightHeader));
+   __atomic_store_n (&flightHeader, header, __ATOMIC_RELEASE);
+
+   printf ("asubExecFlightOpen: recording %d executions to %s (%lu bytes)\n",
+           count, filename, (unsigned long) size);
+   return 0;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecFlightRecord (const char* recordName, const asubExecTrace* trace)
+{
+   asubExecFlightHeader* header = __atomic_load_n (&flightHeader, __ATOMIC_ACQUIRE);
+   if (!header) return;
+
+   const epicsUInt64 ticket = __atomic_fetch_add (&header->next, 1, __ATOMIC_RELAXED);
+   asubExecFlightSlot* slot = &flightSlots [ticket % header->slotCount];
+
+   /* As a seqlock writer: the fence orders the field stores below after the
+    * cleared sequence, which a release store alone does not do.
+    */
+   __atomic_store_n (&slot->sequence, 0, __ATOMIC_RELAXED);
+   __atomic_thread_fence (__ATOMIC_RELEASE);
+
+   strncpy (slot->record, recordName, sizeof (slot->record) - 1);
+   slot->record [sizeof (slot->record) - 1] = '\0';
+   memcpy (slot->time, trace->time, sizeof (slot->time));
+   slot->bytesIn = trace->bytesIn;
+   slot->bytesOut = trace->bytesOut;
+   slot->pid = trace->pid;
+   slot->exitCode = trace->exitCode;
+   slot->flags = trace->flags;
+
+   __atomic_store_n (&slot->sequence, ticket + 1, __ATOMIC_RELEASE);
+}
+
+
+/*------------------------------------------------------------------------------
+ * IOC shell command registration
+ *------------------------------------------------------------------------------
+ */
+static const iocshArg flightArg0 = { "filename", iocshArgString };
+static const iocshArg flightArg1 = { "slots", iocshArgInt };
+static const iocshArg* const flightArgs [] = { &flightArg0, &flightArg1 };
+static const iocshFuncDef flightFuncDef = { "asubExecFlightRecorder", 2, flightArgs };
+
+static void flightCallFunc (const iocshArgBuf* args)
+{
+   asubExecFlightOpen (args[0].sval, args[1].ival);
+}
+
+static void asubExecFlightRegister (void)
+{
+   iocshRegister (&flightFuncDef, flightCallFunc);
+}
+
+epicsExportRegistrar (asubExecFlightRegister);
+
+/* end */
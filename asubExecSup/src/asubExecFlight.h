@@ -0,0 +1,94 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecFlight.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * The asubExec flight recorder. This records the trace of each execution into
+ * a fixed size memory mapped ring file so that recent activity is available
+ * for post-mortem analysis even if the IOC hangs or crashes.
+ * The file may be decoded using asubExecFlight.py
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_FLIGHT_H
+#define ASUB_EXEC_FLIGHT_H 1
+
+#include <epicsTypes.h>
+#include "asubExecTrace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* File layout - all values native endieness.
+ * The file consists of one header followed by slotCount slots.
+ * Must be consistant with asubExecFlight.py
+ */
+#define asubExecFlightMagic     "asubFlt1"
+#define asubExecFlightVersion   1
+
+typedef struct asubExecFlightHeader {
+   char magic [8];                     /* asubExecFlightMagic, no null */
+   epicsUInt32 version;                /* asubExecFlightVersion */
+   epicsUInt32 headerSize;             /* sizeof (asubExecFlightHeader) */
+   epicsUInt32 slotSize;               /* sizeof (asubExecFlightSlot) */
+   epicsUInt32 slotCount;              /* number of slots */
+   epicsUInt64 next;                   /* next ticket - atomically incremented */
+   epicsUInt64 created;                /* nSec since 1970 */
+   epicsInt32 iocPid;                  /* process id of the IOC */
+   char spare [20];                    /* pad to 64 bytes */
+} asubExecFlightHeader;
+
+typedef struct asubExecFlightSlot {
+   epicsUInt64 sequence;               /* 0 when empty or being written, else ticket + 1 */
+   char record [64];                   /* record name, null terminated */
+   epicsUInt64 time [asubExecPhaseCount];
+   epicsUInt64 bytesIn;
+   epicsUInt64 bytesOut;
+   epicsInt32 pid;
+   epicsInt32 exitCode;
+   epicsUInt32 flags;
+   char spare [108];                   /* pad to 256 bytes */
+} asubExecFlightSlot;
+
+/* Opens/creates the flight recorder file with the given number of slots.
+ * Any existing file is first renamed to <filename>.prev
+ * Returns 0 on success.
+ */
+int asubExecFlightOpen (const char* filename, const int slotCount);
+
+/* Records an execution trace.
+ * This is lock free and may be called concurrently from any thread.
+ * It is a no-op if the flight recorder has not been opened.
+ */
+void asubExecFlightRecord (const char* recordName, const asubExecTrace* trace);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_FLIGHT_H */
@@ -0,0 +1,162 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecFlight.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Description
+# Decodes an asubExec flight recorder file, i.e. the trace of the most recent
+# executions as recorded by the IOC. This is primarily intended for post-mortem
+# analysis of hung or crashed IOCs.
+#
+# Copyright (c) 2026 Australian Synchrotron
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# Licence as published by the Free Software Foundation; either
+# version 2.1 of the Licence, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public Licence for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# Licence along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+# Contact details:
+# as-open-source@ansto.gov.au
+# 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+#
+
+"""
+Decodes an asubExec flight recorder file.
+
+usage: asubExecFlight.py [-n last] [-r record] filename
+"""
+
+import argparse
+import datetime
+import struct
+import sys
+
+# Must be consistant with asubExecFlight.h and asubExecTrace.h
+#
+HeaderFormat = "=8sIIIIQQi20x"
+SlotFormat = "=Q64s6QQQiiI108x"
+Magic = b"asubFlt1"
+
+Phases = ("queued", "start", "spawned", "written", "read", "reaped")
+
+Flags = ((0x0001, "failed"),
+         (0x0002, "timeout"),
+         (0x0004, "shutdown"),
+         (0x0008, "latency_minor"),
+         (0x0010, "latency_major"),
+         (0x0020, "shared"))
+
+
+# ------------------------------------------------------------------------------
+#
+def decode(data):
+    """ Returns the header dictionary and the list of slot dictionaries,
+        the latter sorted by sequence number, i.e. oldest first.
+    """
+    header_size = struct.calcsize(HeaderFormat)
+    (magic, version, hsize, slot_size, slot_count,
+     next_ticket, created, ioc_pid) = struct.unpack(HeaderFormat, data[:header_size])
+
+    if magic != Magic:
+        raise ValueError("not an asubExec flight recorder file")
+
+    header = {'version': version, 'slot_size': slot_size, 'slot_count': slot_count,
+              'next': next_ticket, 'created': created, 'ioc_pid': ioc_pid}
+
+    slots = []
+    for j in range(slot_count):
+        offset = hsize + j * slot_size
+        fields = struct.unpack_from(SlotFormat, data, offset)
+        sequence = fields[0]
+        if sequence == 0:
+            continue    # empty or partially written
+
+        slots.append({'sequence': sequence,
+                      'record': fields[1].partition(b"\0")[0].decode("utf8", errors="replace"),
+                      'time': fields[2:8],
+                      'bytes_in': fields[8],
+                      'bytes_out': fields[9],
+                      'pid': fields[10],
+                      'exit_code': fields[11],
+                      'flags': fields[12]})
+
+    slots.sort(key=lambda slot: slot['sequence'])
+    return header, slots
+
+
+# ------------------------------------------------------------------------------
+#
+def timestamp(ns):
+    if ns == 0:
+        return "-"
+    t = datetime.datetime.fromtimestamp(ns / 1.0e9)
+    return t.strftime("%Y-%m-%d %H:%M:%S.%f")
+
+
+# ------------------------------------------------------------------------------
+#
+def phase_ms(times, j):
+    """ Time spent reaching phase j from the previous phase, in mSec """
+    if times[j] == 0 or times[j - 1] == 0:
+        return "-"
+    return "%.3f" % ((times[j] - times[j - 1]) / 1.0e6)
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    parser = argparse.ArgumentParser(description="Decodes an asubExec flight recorder file")
+    parser.add_argument("-n", "--last", type=int, default=0,
+                        help="only show the last N executions")
+    parser.add_argument("-r", "--record", default=None,
+                        help="only show executions of this record")
+    parser.add_argument("filename")
+    args = parser.parse_args()
+
+    with open(args.filename, "rb") as f:
+        data = f.read()
+
+    header, slots = decode(data)
+
+    print("IOC pid %d, created %s, %d executions recorded, %d slots" %
+          (header['ioc_pid'], timestamp(header['created']),
+           header['next'], header['slot_count']))
+
+    if args.record is not None:
+        slots = [s for s in slots if s['record'] == args.record]
+
+    if args.last > 0:
+        slots = slots[-args.last:]
+
+    print("Phase times are mSec since the previous phase")
+    print("%-8s %-26s %-30s %7s  %s %9s %9s %5s  %s" %
+          ("seq", "queued", "record", "pid",
+           " ".join("%9s" % p for p in Phases[1:]),
+           "in", "out", "exit", "flags"))
+
+    for slot in slots:
+        times = slot['time']
+        flags = ",".join(name for (bit, name) in Flags if slot['flags'] & bit)
+        print("%-8d %-26s %-30s %7d  %s %9d %9d %5d  %s" %
+              (slot['sequence'], timestamp(times[0]), slot['record'], slot['pid'],
+               " ".join("%9s" % phase_ms(times, j) for j in range(1, len(Phases))),
+               slot['bytes_in'], slot['bytes_out'], slot['exit_code'], flags))
+
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# end
@@ -0,0 +1,100 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecGlue.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * The record independent part of asubExec - used by both the aSub functions
+ * (asubExecInit/asubExecProcess) and the asubExec record support.
+ * A binding describes how a record type presents its input and output fields.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_GLUE_H
+#define ASUB_EXEC_GLUE_H 1
+
+#include <dbCommon.h>
+#include "asubExecCore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Maximum number of input and output fields of any record type.
+ */
+#define asubExecMaxFields  64
+
+typedef struct asubExecBinding {
+   bool counted;                  /* send version 1.3 counted frames */
+
+   /* Field name prefixes and key format, for diagnostics and info names,
+    * e.g. "FTV" + "A", "FO" + "00", "INTYPE_" + "00", "POST_" + "VAL" + "A".
+    */
+   const char* inputLinkName;
+   const char* inputTypeName;
+   const char* outputTypeName;
+   const char* outputNumberName;
+   const char* outputValueName;
+   void (*key) (const int j, char* key, const size_t size);
+
+   /* Number of inputs and outputs - fixed after initialisation.
+    */
+   void (*count) (dbCommon* prec, int* numberInputs, int* numberOutputs);
+
+   /* Describe the input and output fields for the execution engine.
+    */
+   void (*describe) (dbCommon* prec, asubExecField inputs[], asubExecField outputs[]);
+
+   /* Optional - called by the execute thread with the received output fields
+    * after a successful decode, and with the exit code once reaped.
+    */
+   void (*decoded) (dbCommon* prec, const asubExecField received[]);
+   void (*complete) (dbCommon* prec, const int exitCode);
+} asubExecBinding;
+
+/* Allocates the record's private data, extracts the info fields and starts the
+ * record's execute thread. Returns 0 on success, else -1 (and pact is set).
+ */
+long asubExecAttach (dbCommon* prec, const asubExecBinding* binding);
+
+/* First call (pact false): queues an execution and sets pact, or, if deferred by
+ * the MAXRATE limit, schedules a re-process of the record for when the next token
+ * is due and sets pact only until the record support returns (so monitors and
+ * the forward link are skipped). Returns 0 in either case.
+ * Second call (pact true, from the execute thread): clears pact, raises any
+ * latency alarm and returns the execution status, 0 or -1.
+ */
+long asubExecRequest (dbCommon* prec);
+
+/* Convert from EPICS menuFtype to asubExecDataType.
+ */
+asubExecDataType menuFtype2asubExecDataType (const int type);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_GLUE_H */
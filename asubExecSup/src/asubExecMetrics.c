@@ -0,0 +1,355 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecMetrics.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Periodically writes all asubExec counters and latency histograms to a file
+ * in the Prometheus text exposition format (version 0.0.4), labelled by record
+ * and EXEC, for collection by e.g. the node exporter's textfile collector.
+ *
+ * The file is written to <filename>.tmp and then renamed, so readers always see
+ * a complete file. Only the (lock free) cumulative counters are read, so the
+ * execution path is unaffected.
+ *
+ * IOC shell usage:
+ *
+ *   asubExecMetricsFile ("/run/node_exporter/myioc_asubexec.prom", 15)
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+
+#include <cantProceed.h>
+#include <epicsExport.h>
+#include <epicsString.h>
+#include <epicsThread.h>
+#include <errlog.h>
+#include <iocsh.h>
+
+#include "asubExecStats.h"
+
+typedef struct MetricsConfig {
+   char* filename;
+   char* tempname;
+   double period;
+} MetricsConfig;
+
+/* How a family's samples are derived from the cumulative counters.
+ */
+typedef enum MetricKind {
+   MetricCount,                   /* epicsUInt64 count */
+   MetricSeconds,                 /* epicsUInt64 nSec, written as seconds */
+   MetricHistogram                /* hist row, with an nSec sum */
+} MetricKind;
+
+typedef struct MetricFamily {
+   const char* name;
+   const char* type;
+   const char* help;
+   MetricKind kind;
+   size_t offset;                 /* of the value/hist row in asubExecStatsCounters */
+   size_t sumOffset;              /* of the histogram's sum, MetricHistogram only */
+} MetricFamily;
+
+#define COUNTER(name, help, member) \
+   { name, "counter", help, MetricCount, offsetof (asubExecStatsCounters, member), 0 }
+
+static const MetricFamily families [] = {
+   COUNTER ("asubexec_executions_total", "Total number of executions.", executions),
+   COUNTER ("asubexec_failures_total", "Total number of failed executions.", failures),
+   COUNTER ("asubexec_timeouts_total", "Total number of timed out executions.", timeouts),
+   COUNTER ("asubexec_bytes_in_total", "Total bytes written to child processes.", bytesIn),
+   COUNTER ("asubexec_bytes_out_total", "Total bytes read from child processes.", bytesOut),
+   COUNTER ("asubexec_latency_minor_total", "Total LATENCY_MINOR threshold breaches.",
+            sloMinor),
+   COUNTER ("asubexec_latency_major_total", "Total LATENCY_MAJOR threshold breaches.",
+            sloMajor),
+   COUNTER ("asubexec_deferred_total", "Total requests deferred by MAXRATE.", deferred),
+   COUNTER ("asubexec_clamped_total", "Total output elements clamped by POST_x.", clamped),
+   COUNTER ("asubexec_nans_total", "Total NaN output elements seen by POST_x.", nans),
+   COUNTER ("asubexec_perf_executions_total", "Total executions with perf counters.",
+            perfExecutions),
+   COUNTER ("asubexec_cycles_total", "Total child process CPU cycles.",
+            perf [asubExecPerfCycles]),
+   COUNTER ("asubexec_instructions_total", "Total child process instructions.",
+            perf [asubExecPerfInstructions]),
+   COUNTER ("asubexec_page_faults_total", "Total child process page faults.",
+            perf [asubExecPerfPageFaults]),
+   COUNTER ("asubexec_context_switches_total", "Total child process context switches.",
+            perf [asubExecPerfContextSwitches]),
+   COUNTER ("asubexec_exec_cache_hits_total", "Total EXECLINK program cache hits.",
+            execHits),
+   COUNTER ("asubexec_exec_cold_starts_total", "Total EXECLINK program cold starts.",
+            execColdStarts),
+   COUNTER ("asubexec_worker_recycles_total", "Total persistent workers recycled.",
+            recycles),
+   COUNTER ("asubexec_detached_total", "Total detached child processes started.",
+            detached),
+   COUNTER ("asubexec_detached_failures_total",
+            "Total detached child processes failed or timed out.", detachedFailures),
+   COUNTER ("asubexec_detached_rejected_total", "Total requests rejected by DETACHED_MAX.",
+            detachedRejected),
+   { "asubexec_task_clock_seconds_total", "counter", "Total child process task clock.",
+     MetricSeconds, offsetof (asubExecStatsCounters, perf [asubExecPerfTaskClock]), 0 },
+   { "asubexec_latency_max_seconds", "gauge", "Maximum end to end latency.",
+     MetricSeconds, offsetof (asubExecStatsCounters, latencyMax), 0 },
+   { "asubexec_latency_seconds", "histogram", "End to end execution latency.",
+     MetricHistogram, offsetof (asubExecStatsCounters, hist [asubExecStatsLatencyHist]),
+     offsetof (asubExecStatsCounters, latencySum) },
+   { "asubexec_queue_wait_seconds", "histogram",
+     "Time from record processing to execution start.",
+     MetricHistogram, offsetof (asubExecStatsCounters, hist [asubExecStatsQueueHist]),
+     offsetof (asubExecStatsCounters, queueSum) }
+};
+
+#undef COUNTER
+
+typedef struct WriteContext {
+   FILE* file;
+   int family;
+} WriteContext;
+
+
+/*------------------------------------------------------------------------------
+ * Writes a label value escaped as per the exposition format.
+ */
+static void writeLabelValue (FILE* file, const char* value)
+{
+   const char* p;
+   for (p = value ? value : ""; *p; p++) {
+      switch (*p) {
+         case '\\': fputs ("\\\\", file); break;
+         case '"':  fputs ("\\\"", file); break;
+         case '\n': fputs ("\\n", file);  break;
+         default:   fputc (*p, file);     break;
+      }
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void writeLabels (FILE* file, const asubExecStats* stats, const char* le)
+{
+   fputs ("{record=\"", file);
+   writeLabelValue (file, stats->recordName);
+   fputs ("\",exec=\"", file);
+   writeLabelValue (file, stats->exec);
+   fputc ('"', file);
+   if (le) {
+      fprintf (file, ",le=\"%s\"", le);
+   }
+   fputc ('}', file);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void writeHistogram (FILE* file, const asubExecStats* stats, const char* name,
+                            const epicsUInt64* counts, const epicsUInt64 sumNs)
+{
+   epicsUInt64 cumulative = 0;
+   char le [32];
+   int k;
+
+   for (k = 0; k < asubExecStatsBuckets; k++) {
+      cumulative += counts [k];
+      if (k < asubExecStatsBuckets - 1) {
+         snprintf (le, sizeof (le), "%g", asubExecStatsBucketLimit (k));
+      } else {
+         snprintf (le, sizeof (le), "+Inf");
+      }
+      fprintf (file, "%s_bucket", name);
+      writeLabels (file, stats, le);
+      fprintf (file, " %llu\n", (unsigned long long) cumulative);
+   }
+
+   fprintf (file, "%s_sum", name);
+   writeLabels (file, stats, NULL);
+   fprintf (file, " %.9f\n", (double) sumNs * 1.0e-9);
+
+   fprintf (file, "%s_count", name);
+   writeLabels (file, stats, NULL);
+   fprintf (file, " %llu\n", (unsigned long long) cumulative);
+}
+
+/*------------------------------------------------------------------------------
+ * Iterator function - writes the current family's sample(s) for one record.
+ */
+static void writeSamples (asubExecStats* stats, void* context)
+{
+   WriteContext* wc = (WriteContext*) context;
+   FILE* file = wc->file;
+   const MetricFamily* f = &families [wc->family];
+   asubExecStatsCounters c;
+
+   if (!stats->exec) return;     /* no such asubExec record */
+
+   asubExecStatsSnapshot (stats, &c);
+
+   const char* base = (const char*) &c;
+   const epicsUInt64* value = (const epicsUInt64*) (base + f->offset);
+
+   switch (f->kind) {
+      case MetricCount:
+         fputs (f->name, file);
+         writeLabels (file, stats, NULL);
+         fprintf (file, " %llu\n", (unsigned long long) *value);
+         break;
+
+      case MetricSeconds:
+         fputs (f->name, file);
+         writeLabels (file, stats, NULL);
+         fprintf (file, " %.9f\n", (double) *value * 1.0e-9);
+         break;
+
+      case MetricHistogram:
+         writeHistogram (file, stats, f->name, value,
+                         *(const epicsUInt64*) (base + f->sumOffset));
+         break;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * Errors are only reported if verbose, so that a persistent failure does not
+ * flood the IOC log.
+ */
+static bool writeMetricsFile (const MetricsConfig* config, const bool verbose)
+{
+   FILE* file = fopen (config->tempname, "w");
+   if (!file) {
+      if (verbose) errlogPrintf ("asubExecMetrics: fopen (%s) failed: %s\n",
+                                 config->tempname, strerror (errno));
+      return false;
+   }
+
+   WriteContext wc;
+   wc.file = file;
+
+   for (wc.family = 0; wc.family < (int) (sizeof (families) / sizeof (families [0]));
+        wc.family++) {
+      const MetricFamily* f = &families [wc.family];
+      fprintf (file, "# HELP %s %s\n", f->name, f->help);
+      fprintf (file, "# TYPE %s %s\n", f->name, f->type);
+      asubExecStatsIterate (writeSamples, &wc);
+   }
+
+   /* IOC wide - not per record.
+    */
+   double mean, peak;
+   asubExecStatsConcurrencyValues (&mean, &peak);
+   fputs ("# HELP asubexec_concurrency Mean executions in flight over the last period.\n"
+          "# TYPE asubexec_concurrency gauge\n", file);
+   fprintf (file, "asubexec_concurrency %.6f\n", mean);
+   fputs ("# HELP asubexec_concurrency_peak Peak executions in flight over the last period.\n"
+          "# TYPE asubexec_concurrency_peak gauge\n", file);
+   fprintf (file, "asubexec_concurrency_peak %.0f\n", peak);
+
+   const bool okay = !ferror (file);
+   if (fclose (file) != 0 || !okay) {
+      if (verbose) errlogPrintf ("asubExecMetrics: write (%s) failed\n", config->tempname);
+      return false;
+   }
+
+   if (rename (config->tempname, config->filename) != 0) {
+      if (verbose) errlogPrintf ("asubExecMetrics: rename (%s) failed: %s\n",
+                                 config->filename, strerror (errno));
+      return false;
+   }
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void metricsThread (void* arg)
+{
+   MetricsConfig* config = (MetricsConfig*) arg;
+   bool okay = true;
+
+   while (true) {
+      epicsThreadSleep (config->period);
+
+      /* Only report the first failure of a sequence of failures.
+       */
+      okay = writeMetricsFile (config, okay);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * IOC shell command
+ */
+static void asubExecMetricsFile (const char* filename, double period)
+{
+   static bool started = false;
+
+   if (!filename || !filename[0]) {
+      printf ("usage: asubExecMetricsFile filename [period]\n");
+      return;
+   }
+   if (started) {
+      errlogPrintf ("asubExecMetricsFile: already configured\n");
+      return;
+   }
+
+   MetricsConfig* config = (MetricsConfig*) callocMustSucceed (1, sizeof (MetricsConfig),
+                                                               "asubExecMetricsFile");
+   const size_t tempSize = strlen (filename) + 5;
+   config->filename = epicsStrDup (filename);
+   config->tempname = (char*) mallocMustSucceed (tempSize, "asubExecMetricsFile");
+   snprintf (config->tempname, tempSize, "%s.tmp", filename);
+   config->period = period >= 1.0 ? period : 15.0;
+
+   started = true;
+   epicsThreadMustCreate ("asubExecMetrics", epicsThreadPriorityLow,
+                          epicsThreadGetStackSize (epicsThreadStackSmall),
+                          metricsThread, config);
+
+   printf ("asubExecMetricsFile: writing %s every %.1fs\n", filename, config->period);
+}
+
+static const iocshArg metricsArg0 = { "filename", iocshArgString };
+static const iocshArg metricsArg1 = { "period", iocshArgDouble };
+static const iocshArg* const metricsArgs [] = { &metricsArg0, &metricsArg1 };
+static const iocshFuncDef metricsFuncDef = { "asubExecMetricsFile", 2, metricsArgs };
+
+static void metricsCallFunc (const iocshArgBuf* args)
+{
+   asubExecMetricsFile (args[0].sval, args[1].dval);
+}
+
+static void asubExecMetricsRegister (void)
+{
+   iocshRegister (&metricsFuncDef, metricsCallFunc);
+}
+
+epicsExportRegistrar (asubExecMetricsRegister);
+
+/* end */
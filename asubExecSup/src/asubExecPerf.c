@@ -0,0 +1,197 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecPerf.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * asubExec per child process performance counters - see asubExecPerf.h
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include "asubExecPerf.h"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#endif
+
+static const char* const counterNames [asubExecPerfCount] = {
+   "cycles", "instructions", "task_clock", "page_faults", "context_switches"
+};
+
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecPerfInit (asubExecPerf* perf)
+{
+   int j;
+   for (j = 0; j < asubExecPerfCount; j++) {
+      perf->fd[j] = -1;
+   }
+}
+
+#ifdef __linux__
+
+/*------------------------------------------------------------------------------
+ * There is no glibc wrapper for perf_event_open.
+ */
+static int perfEventOpen (struct perf_event_attr* attr, const pid_t pid)
+{
+   return (int) syscall (__NR_perf_event_open, attr, pid, -1, -1, PERF_FLAG_FD_CLOEXEC);
+}
+
+/*------------------------------------------------------------------------------
+ * Opens one counter, user space only if the kernel will not allow more
+ * (see /proc/sys/kernel/perf_event_paranoid).
+ */
+static int openCounter (const uint32_t type, const uint64_t config,
+                        const pid_t pid, const bool onExec)
+{
+   struct perf_event_attr attr;
+   int fd;
+
+   memset (&attr, 0, sizeof (attr));
+   attr.size = sizeof (attr);
+   attr.type = type;
+   attr.config = config;
+   attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+   attr.disabled = onExec ? 1 : 0;
+   attr.enable_on_exec = onExec ? 1 : 0;
+   attr.inherit = 1;
+   attr.exclude_hv = 1;
+
+   fd = perfEventOpen (&attr, pid);
+   if (fd < 0 && (errno == EACCES || errno == EPERM)) {
+      attr.exclude_kernel = 1;
+      fd = perfEventOpen (&attr, pid);
+   }
+   return fd;
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecPerfOpen (asubExecPerf* perf, const pid_t pid, const bool onExec)
+{
+   static const struct {
+      uint32_t type;
+      uint64_t config;
+   } events [asubExecPerfCount] = {
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+      { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+      { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+      { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+      { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES }
+   };
+   int j;
+
+   for (j = 0; j < asubExecPerfCount; j++) {
+      perf->fd[j] = openCounter (events[j].type, events[j].config, pid, onExec);
+   }
+   return asubExecPerfIsOpen (perf);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecPerfRead (const asubExecPerf* perf, uint64_t values[asubExecPerfCount])
+{
+   int j;
+
+   for (j = 0; j < asubExecPerfCount; j++) {
+      uint64_t data [3];     /* value, time enabled, time running */
+
+      values[j] = 0;
+      if (perf->fd[j] < 0) continue;
+      if (read (perf->fd[j], data, sizeof (data)) != (ssize_t) sizeof (data)) continue;
+
+      if (data[2] == 0) continue;     /* never scheduled */
+      if (data[2] < data[1]) {
+         values[j] = (uint64_t) ((double) data[0] * (double) data[1] / (double) data[2]);
+      } else {
+         values[j] = data[0];
+      }
+   }
+}
+
+#else
+
+/*------------------------------------------------------------------------------
+ * No performance counters on this platform.
+ */
+bool asubExecPerfOpen (asubExecPerf* perf, const pid_t pid, const bool onExec)
+{
+   asubExecPerfInit (perf);
+   return false;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecPerfRead (const asubExecPerf* perf, uint64_t values[asubExecPerfCount])
+{
+   int j;
+   for (j = 0; j < asubExecPerfCount; j++) {
+      values[j] = 0;
+   }
+}
+
+#endif
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecPerfClose (asubExecPerf* perf)
+{
+   int j;
+   for (j = 0; j < asubExecPerfCount; j++) {
+      if (perf->fd[j] >= 0) close (perf->fd[j]);
+      perf->fd[j] = -1;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+bool asubExecPerfIsOpen (const asubExecPerf* perf)
+{
+   int j;
+   for (j = 0; j < asubExecPerfCount; j++) {
+      if (perf->fd[j] >= 0) return true;
+   }
+   return false;
+}
+
+/*------------------------------------------------------------------------------
+ */
+const char* asubExecPerfName (const asubExecPerfCounter counter)
+{
+   if (counter < 0 || counter >= asubExecPerfCount) return "";
+   return counterNames [counter];
+}
+
+/* end */
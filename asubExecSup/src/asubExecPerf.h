@@ -0,0 +1,97 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecPerf.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Per child process performance counters (Linux perf_event_open).
+ *
+ * Counters are attached to a child process as it is started and are inherited
+ * by any processes and threads it creates in turn. Hardware counters (cycles,
+ * instructions) are frequently unavailable, e.g. within virtual machines, in
+ * which case only the software counters (task clock, page faults and context
+ * switches) are available.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_PERF_H
+#define ASUB_EXEC_PERF_H 1
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum asubExecPerfCounter {
+   asubExecPerfCycles = 0,             /* hardware */
+   asubExecPerfInstructions,           /* hardware */
+   asubExecPerfTaskClock,              /* software, nSec */
+   asubExecPerfPageFaults,             /* software */
+   asubExecPerfContextSwitches,        /* software */
+   asubExecPerfCount                   /* Must be last */
+} asubExecPerfCounter;
+
+/* Open counter file descriptors, -1 if not open.
+ */
+typedef struct asubExecPerf {
+   int fd [asubExecPerfCount];
+} asubExecPerf;
+
+/* Marks all counters as not open.
+ */
+void asubExecPerfInit (asubExecPerf* perf);
+
+/* Opens the counters for process pid. If onExec, counting starts when the
+ * process next calls exec, otherwise immediately.
+ * Returns true if and only if at least one counter was opened.
+ */
+bool asubExecPerfOpen (asubExecPerf* perf, const pid_t pid, const bool onExec);
+
+/* Reads the counters. Counts are scaled if the kernel had to multiplex the
+ * hardware counters. Counters not open read as 0.
+ */
+void asubExecPerfRead (const asubExecPerf* perf, uint64_t values[asubExecPerfCount]);
+
+/* Closes any open counters.
+ */
+void asubExecPerfClose (asubExecPerf* perf);
+
+/* True if any counter is open.
+ */
+bool asubExecPerfIsOpen (const asubExecPerf* perf);
+
+/* Counter name, e.g. "cycles".
+ */
+const char* asubExecPerfName (const asubExecPerfCounter counter);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_PERF_H */
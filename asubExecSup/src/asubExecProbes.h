@@ -0,0 +1,75 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecProbes.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * USDT (user level statically defined tracing) probes at each phase of an
+ * execution, for use with bpftrace, perf, SystemTap etc., e.g.:
+ *
+ *   bpftrace -e 'usdt:./asubExecTest:asubExec:complete { @[str(arg0)] = hist(arg4); }'
+ *
+ * Probes are compiled in when <sys/sdt.h> is available (systemtap-sdt-devel on
+ * RedHat derivatives, systemtap-sdt-dev on Debian derivatives) unless
+ * ASUB_EXEC_NO_PROBES is defined, and otherwise compile to nothing.
+ * A probe that is not being traced costs a single nop instruction.
+ *
+ * Probe             Arguments
+ * queue             record
+ * spawn_start       record
+ * spawn_end         record, pid
+ * write_start       record, pid
+ * write_end         record, pid, bytes
+ * read_start        record, pid
+ * read_end          record, pid, bytes
+ * reap              record, pid, exit code
+ * complete          record, pid, exit code, trace flags, latency (nSec)
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_PROBES_H
+#define ASUB_EXEC_PROBES_H 1
+
+#if !defined(ASUB_EXEC_NO_PROBES) && defined(__has_include)
+#  if __has_include(<sys/sdt.h>)
+#    include <sys/sdt.h>
+#    define ASUB_EXEC_HAS_PROBES 1
+#  endif
+#endif
+
+#ifdef ASUB_EXEC_HAS_PROBES
+#  define ASUB_EXEC_PROBE1(name, a)              DTRACE_PROBE1 (asubExec, name, a)
+#  define ASUB_EXEC_PROBE2(name, a, b)           DTRACE_PROBE2 (asubExec, name, a, b)
+#  define ASUB_EXEC_PROBE3(name, a, b, c)        DTRACE_PROBE3 (asubExec, name, a, b, c)
+#  define ASUB_EXEC_PROBE5(name, a, b, c, d, e)  DTRACE_PROBE5 (asubExec, name, a, b, c, d, e)
+#else
+#  define ASUB_EXEC_PROBE1(name, a)
+#  define ASUB_EXEC_PROBE2(name, a, b)
+#  define ASUB_EXEC_PROBE3(name, a, b, c)
+#  define ASUB_EXEC_PROBE5(name, a, b, c, d, e)
+#endif
+
+#endif  /* ASUB_EXEC_PROBES_H */
@@ -0,0 +1,486 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecRecord.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Record support for the asubExec record.
+ *
+ * The asubExec record is a dedicated alternative to the aSub record used with
+ * asubExecInit/asubExecProcess. It has NIN inputs and NOUT outputs (up to 64
+ * of each), each being an array of type FInn/FOnn with NInn/NOnn elements
+ * allocated at initialisation, and it is driven by the same execution engine.
+ * The number of elements read/written is held in EInn/EOnn. VAL is set to the
+ * child process' exit code.
+ *
+ * Version 1.3 counted frames are used, so the child receives exactly NIN inputs
+ * and NOUT output specifications, keyed 00, 01 ... 63 by asubExec.py.
+ * The info fields (EXEC, ARGn, TIMEOUT, BACKEND, INTYPE_nn, LATENCY_x, MAXRATE)
+ * are as for the aSub record. A request deferred by MAXRATE returns as for a
+ * queued execution; the record is re-processed when the next token is due.
+ *
+ * Example:
+ *
+ * record (asubExec, "RECORD_NAME") {
+ *   info (EXEC, "exectuable_file")
+ *   field (NIN,  "2")
+ *   field (IN00, "SOURCE:WAVEFORM CP")
+ *   field (FI00, "SHORT")
+ *   field (NI00, "100000")
+ *   field (IN01, "2.5")
+ *   field (NOUT, "1")
+ *   field (OU00, "TARGET:WAVEFORM PP")
+ *   field (NO00, "100000")
+ * }
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <alarm.h>
+#include <cantProceed.h>
+#include <dbAccess.h>
+#include <dbDefs.h>
+#include <dbEvent.h>
+#include <dbLink.h>
+#include <epicsAssert.h>
+#include <epicsExport.h>
+#include <epicsVersion.h>
+#include <errlog.h>
+#include <menuFtype.h>
+#include <recGbl.h>
+#include <recSup.h>
+#include <special.h>
+
+#define GEN_SIZE_OFFSET
+#include "asubExecRecord.h"
+#undef  GEN_SIZE_OFFSET
+
+#include "asubExecGlue.h"
+
+/* Record support indexes each group of fields from its nn = 00 field, so the
+ * groups must be complete and contiguous - as generated by asubExecRecordDbd.py.
+ */
+#define FIELD_GROUP(first, last)                                                   \
+   STATIC_ASSERT (asubExecRecord##last - asubExecRecord##first == asubExecMaxFields - 1);
+
+#define FIELD_ARRAY(first, last)                                                   \
+   STATIC_ASSERT (offsetof (asubExecRecord, last) - offsetof (asubExecRecord, first) == \
+                  (asubExecMaxFields - 1) * sizeof (((asubExecRecord*) 0)->first));
+
+FIELD_GROUP (IN00, IN63)
+FIELD_GROUP (FI00, FI63)
+FIELD_GROUP (NI00, NI63)
+FIELD_GROUP (EI00, EI63)
+FIELD_GROUP (I00, I63)
+FIELD_GROUP (OU00, OU63)
+FIELD_GROUP (FO00, FO63)
+FIELD_GROUP (NO00, NO63)
+FIELD_GROUP (EO00, EO63)
+FIELD_GROUP (O00, O63)
+
+FIELD_ARRAY (in00, in63)
+FIELD_ARRAY (fi00, fi63)
+FIELD_ARRAY (ni00, ni63)
+FIELD_ARRAY (ei00, ei63)
+FIELD_ARRAY (i00, i63)
+FIELD_ARRAY (ou00, ou63)
+FIELD_ARRAY (fo00, fo63)
+FIELD_ARRAY (no00, no63)
+FIELD_ARRAY (eo00, eo63)
+FIELD_ARRAY (o00, o63)
+
+/* Create RSET - Record Support Entry Table
+ */
+#define report NULL
+#define initialize NULL
+static long init_record (struct dbCommon* pcommon, int pass);
+static long process (struct dbCommon* pcommon);
+#define special NULL
+#define get_value NULL
+static long cvt_dbaddr (DBADDR* paddr);
+static long get_array_info (DBADDR* paddr, long* no_elements, long* offset);
+static long put_array_info (DBADDR* paddr, long nNew);
+#define get_units NULL
+#define get_precision NULL
+#define get_enum_str NULL
+#define get_enum_strs NULL
+#define put_enum_str NULL
+#define get_graphic_double NULL
+#define get_control_double NULL
+#define get_alarm_double NULL
+
+rset asubExecRSET = {
+   RSETNUMBER,
+   report,
+   initialize,
+   init_record,
+   process,
+   special,
+   get_value,
+   cvt_dbaddr,
+   get_array_info,
+   put_array_info,
+   get_units,
+   get_precision,
+   get_enum_str,
+   get_enum_strs,
+   put_enum_str,
+   get_graphic_double,
+   get_control_double,
+   get_alarm_double
+};
+
+epicsExportAddress (rset, asubExecRSET);
+
+
+/*------------------------------------------------------------------------------
+ * asubExec binding - fields I00, I01, ... and O00, O01, ...
+ *------------------------------------------------------------------------------
+ */
+static void recordKey (const int j, char* key, const size_t size)
+{
+   snprintf (key, size, "%02d", j);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void recordCount (dbCommon* pcommon, int* numberInputs, int* numberOutputs)
+{
+   asubExecRecord* prec = (asubExecRecord*) pcommon;
+   *numberInputs = prec->nin;
+   *numberOutputs = prec->nout;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void recordDescribe (dbCommon* pcommon, asubExecField inputs[],
+                            asubExecField outputs[])
+{
+   asubExecRecord* prec = (asubExecRecord*) pcommon;
+   int j;
+
+   for (j = 0; j < prec->nin; j++) {
+      inputs[j].type = menuFtype2asubExecDataType ((&prec->fi00)[j]);
+      inputs[j].number = (&prec->ei00)[j];
+      inputs[j].data = (&prec->i00)[j];
+   }
+
+   for (j = 0; j < prec->nout; j++) {
+      outputs[j].type = menuFtype2asubExecDataType ((&prec->fo00)[j]);
+      outputs[j].number = (&prec->no00)[j];
+      outputs[j].data = (&prec->o00)[j];
+   }
+}
+
+/*------------------------------------------------------------------------------
+ * The number of elements written to each output is the number received,
+ * limited to NOnn. Discarded (string/number mis-match) outputs are not written.
+ */
+static void recordDecoded (dbCommon* pcommon, const asubExecField received[])
+{
+   asubExecRecord* prec = (asubExecRecord*) pcommon;
+   int j;
+
+   for (j = 0; j < prec->nout; j++) {
+      const asubExecDataType type = menuFtype2asubExecDataType ((&prec->fo00)[j]);
+      const epicsUInt32 maximum = (&prec->no00)[j];
+      epicsUInt32 number = received[j].number <= maximum ? received[j].number : maximum;
+
+      if ((received[j].type != type) &&
+          !(asubExecTypeIsNumeric (received[j].type) && asubExecTypeIsNumeric (type))) {
+         number = 0;
+      }
+
+      (&prec->eo00)[j] = number;
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void recordComplete (dbCommon* pcommon, const int exitCode)
+{
+   asubExecRecord* prec = (asubExecRecord*) pcommon;
+   prec->val = exitCode;
+}
+
+static const asubExecBinding recordBinding = {
+   true, "IN", "FI", "FO", "NO", "O", recordKey, recordCount, recordDescribe,
+   recordDecoded, recordComplete
+};
+
+
+/*------------------------------------------------------------------------------
+ * Allocate the value arrays - at least one element each.
+ */
+static void allocateFields (asubExecRecord* prec, const int number,
+                            epicsEnum16* ftype, epicsUInt32* nelm,
+                            epicsUInt32* nelem, void** value)
+{
+   int j;
+
+   for (j = 0; j < number; j++) {
+      if (ftype[j] >= menuFtype_NUM_CHOICES) {
+         errlogPrintf ("%s asubExec: invalid field type %d, using DOUBLE\n",
+                       prec->name, ftype[j]);
+         ftype[j] = menuFtypeDOUBLE;
+      }
+      if (nelm[j] == 0) nelm[j] = 1;
+
+      value[j] = callocMustSucceed (nelm[j], dbValueSize (ftype[j]), "asubExecRecord");
+      nelem[j] = nelm[j];
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+static long init_record (struct dbCommon* pcommon, int pass)
+{
+   asubExecRecord* prec = (asubExecRecord*) pcommon;
+   int j;
+
+   if (pass == 0) {
+      if (prec->nin > asubExecMaxFields) {
+         errlogPrintf ("%s asubExec: NIN %d exceeds %d\n", prec->name, prec->nin,
+                       asubExecMaxFields);
+         prec->nin = asubExecMaxFields;
+      }
+      if (prec->nout > asubExecMaxFields) {
+         errlogPrintf ("%s asubExec: NOUT %d exceeds %d\n", prec->name, prec->nout,
+                       asubExecMaxFields);
+         prec->nout = asubExecMaxFields;
+      }
+
+      allocateFields (prec, prec->nin, &prec->fi00, &prec->ni00, &prec->ei00, &prec->i00);
+      allocateFields (prec, prec->nout, &prec->fo00, &prec->no00, &prec->eo00, &prec->o00);
+      return 0;
+   }
+
+   /* Constant input links provide initial values.
+    */
+   for (j = 0; j < prec->nin; j++) {
+      DBLINK* plink = &(&prec->in00)[j];
+
+#if EPICS_VERSION >= 7
+      if (dbLinkIsConstant (plink)) {
+         long number = (&prec->ni00)[j];
+         if (dbLoadLinkArray (plink, (&prec->fi00)[j], (&prec->i00)[j], &number) == 0) {
+            (&prec->ei00)[j] = number;
+         }
+      }
+#else
+      if (plink->type == CONSTANT) {
+         recGblInitConstantLink (plink, (&prec->fi00)[j], (&prec->i00)[j]);
+      }
+#endif
+   }
+
+   return asubExecAttach (pcommon, &recordBinding);
+}
+
+/*------------------------------------------------------------------------------
+ * Read all input links - the number of elements read is saved in EInn, which
+ * is zero if the link provided no data. Constant links keep the values loaded
+ * at initialisation.
+ */
+static long fetchValues (asubExecRecord* prec)
+{
+   int j;
+
+   for (j = 0; j < prec->nin; j++) {
+      DBLINK* plink = &(&prec->in00)[j];
+      long number = (&prec->ni00)[j];
+
+#if EPICS_VERSION >= 7
+      if (dbLinkIsConstant (plink)) continue;
+#else
+      if (plink->type == CONSTANT) continue;
+#endif
+
+      if (dbGetLink (plink, (&prec->fi00)[j], (&prec->i00)[j], 0, &number)) {
+         recGblSetSevr (prec, LINK_ALARM, INVALID_ALARM);
+         return -1;
+      }
+      (&prec->ei00)[j] = number;
+   }
+
+   return 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Write EOnn elements of each output to its output link.
+ */
+static long putValues (asubExecRecord* prec)
+{
+   long status = 0;
+   int j;
+
+   for (j = 0; j < prec->nout; j++) {
+      const long number = (&prec->eo00)[j];
+      if (number == 0) continue;
+
+      if (dbPutLink (&(&prec->ou00)[j], (&prec->fo00)[j], (&prec->o00)[j], number)) {
+         recGblSetSevr (prec, LINK_ALARM, INVALID_ALARM);
+         status = -1;
+      }
+   }
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void monitor (asubExecRecord* prec)
+{
+   const unsigned short mask = recGblResetAlarms (prec) | DBE_VALUE | DBE_LOG;
+   int j;
+
+   db_post_events (prec, &prec->val, mask);
+
+   for (j = 0; j < prec->nout; j++) {
+      db_post_events (prec, (&prec->o00)[j], mask);
+      db_post_events (prec, &(&prec->eo00)[j], mask);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+static long process (struct dbCommon* pcommon)
+{
+   asubExecRecord* prec = (asubExecRecord*) pcommon;
+   const int pact = prec->pact;
+   long status = 0;
+
+   if (!pact) {
+      prec->udf = FALSE;
+      status = fetchValues (prec);
+   }
+
+   if (!status) {
+      status = asubExecRequest (pcommon);
+      if (!pact && prec->pact) return 0;   /* execution queued or deferred */
+
+      if (status < 0) {
+         recGblSetSevr (prec, SOFT_ALARM, INVALID_ALARM);
+      } else if (status == 0) {
+         status = putValues (prec);
+      }
+   }
+
+   prec->pact = TRUE;
+   recGblGetTimeStamp (prec);
+   monitor (prec);
+   recGblFwdLink (prec);
+   prec->pact = FALSE;
+
+   return status;
+}
+
+/*------------------------------------------------------------------------------
+ * Array field access - the Inn and Onn fields.
+ */
+static long cvt_dbaddr (DBADDR* paddr)
+{
+   asubExecRecord* prec = (asubExecRecord*) paddr->precord;
+   const int index = dbGetFieldIndex (paddr);
+   int j;
+
+   j = index - asubExecRecordI00;
+   if (j >= 0 && j < asubExecMaxFields) {
+      const epicsEnum16 ftype = (&prec->fi00)[j];
+      if (j >= prec->nin) return S_db_badField;
+      paddr->pfield = (&prec->i00)[j];
+      paddr->no_elements = (&prec->ni00)[j];
+      paddr->field_type = ftype;
+      paddr->field_size = dbValueSize (ftype);
+      paddr->dbr_field_type = ftype;
+      return 0;
+   }
+
+   j = index - asubExecRecordO00;
+   if (j >= 0 && j < asubExecMaxFields) {
+      const epicsEnum16 ftype = (&prec->fo00)[j];
+      if (j >= prec->nout) return S_db_badField;
+      paddr->pfield = (&prec->o00)[j];
+      paddr->no_elements = (&prec->no00)[j];
+      paddr->field_type = ftype;
+      paddr->field_size = dbValueSize (ftype);
+      paddr->dbr_field_type = ftype;
+      return 0;
+   }
+
+   return 0;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static long get_array_info (DBADDR* paddr, long* no_elements, long* offset)
+{
+   asubExecRecord* prec = (asubExecRecord*) paddr->precord;
+   const int index = dbGetFieldIndex (paddr);
+   int j;
+
+   j = index - asubExecRecordI00;
+   if (j >= 0 && j < asubExecMaxFields) {
+      *no_elements = (&prec->ei00)[j];
+   } else {
+      j = index - asubExecRecordO00;
+      *no_elements = (j >= 0 && j < asubExecMaxFields) ? (&prec->eo00)[j] : 0;
+   }
+
+   *offset = 0;
+   return 0;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static long put_array_info (DBADDR* paddr, long nNew)
+{
+   asubExecRecord* prec = (asubExecRecord*) paddr->precord;
+   const int index = dbGetFieldIndex (paddr);
+   int j;
+
+   j = index - asubExecRecordI00;
+   if (j >= 0 && j < asubExecMaxFields) {
+      (&prec->ei00)[j] = nNew;
+      return 0;
+   }
+
+   j = index - asubExecRecordO00;
+   if (j >= 0 && j < asubExecMaxFields) {
+      (&prec->eo00)[j] = nNew;
+   }
+
+   return 0;
+}
+
+/* end */
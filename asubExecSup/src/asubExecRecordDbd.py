@@ -0,0 +1,179 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecRecordDbd.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Description
+# Generates asubExecRecord.dbd, the asubExec record type definition, at build
+# time. The record support (asubExecRecord.c) indexes each group of per input
+# and per output fields from its nn = 00 field, so the groups must be complete
+# and contiguous, which is why the definition is generated and not edited.
+#
+# Copyright (c) 2026 Australian Synchrotron
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# Licence as published by the Free Software Foundation; either
+# version 2.1 of the Licence, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public Licence for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# Licence along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+# Contact details:
+# as-open-source@ansto.gov.au
+# 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+#
+
+"""
+Generates the asubExec record type definition.
+
+usage: asubExecRecordDbd.py [output_file]
+
+Writes to standard output if no output file is specified.
+"""
+
+import sys
+
+# Must be consistant with asubExecMaxFields in asubExecGlue.h
+#
+MaxFields = 64
+
+Header = """\
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecRecord.dbd $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# The asubExec record - as the aSub record used with asubExecInit/asubExecProcess,
+# but with up to 64 inputs and outputs, each an array of configurable type and
+# maximum size. Requires EPICS 3.15 or later.
+#
+# INnn/FInn/NInn/EInn/Inn - input link, type, max and current elements, value.
+# OUnn/FOnn/NOnn/EOnn/Onn - output link, type, max and current elements, value.
+# Each group of fields is contiguous, so may be indexed from the nn = 00 field.
+#
+# Note: this file is generated by asubExecRecordDbd.py - do not edit.
+#
+
+include "menuFtype.dbd"
+
+recordtype (asubExec) {
+    include "dbCommon.dbd"
+    field (VAL, DBF_LONG) {
+        prompt ("Exit Code")
+        asl (ASL0)
+    }
+    field (NIN, DBF_USHORT) {
+        prompt ("Number of Inputs")
+        promptgroup ("40 - Input")
+        special (SPC_NOMOD)
+        interest (1)
+        initial ("1")
+    }
+    field (NOUT, DBF_USHORT) {
+        prompt ("Number of Outputs")
+        promptgroup ("50 - Output")
+        special (SPC_NOMOD)
+        interest (1)
+        initial ("1")
+    }
+"""
+
+Footer = """\
+}
+
+# end
+"""
+
+
+# ------------------------------------------------------------------------------
+#
+def prompt_group(base, title, j):
+    """ e.g. "42 - Input 10-19" """
+    first = 10 * (j // 10)
+    last = min(first + 9, MaxFields - 1)
+    return "%d - %s %02d-%02d" % (base + 1 + j // 10, title, first, last)
+
+
+# ------------------------------------------------------------------------------
+#
+def field_group(lines, title, base, link_name, link_type, type_name, max_name,
+                number_name, value_name):
+    """ Appends the link, type, max elements, elements and value fields, each
+        as a contiguous group of MaxFields fields.
+    """
+    def field(name, dbf, attributes):
+        lines.append("    field (%s, %s) {" % (name, dbf))
+        lines.extend("        %s" % a for a in attributes)
+        lines.append("    }")
+
+    for j in range(MaxFields):
+        field("%s%02d" % (link_name, j), link_type,
+              ['prompt ("%s Link %02d")' % (title, j),
+               'promptgroup ("%s")' % prompt_group(base, title, j),
+               'interest (1)'])
+
+    for j in range(MaxFields):
+        field("%s%02d" % (type_name, j), "DBF_MENU",
+              ['prompt ("Type of %s %02d")' % (title, j),
+               'promptgroup ("%s")' % prompt_group(base, title, j),
+               'special (SPC_NOMOD)',
+               'interest (1)',
+               'menu (menuFtype)',
+               'initial ("DOUBLE")'])
+
+    for j in range(MaxFields):
+        field("%s%02d" % (max_name, j), "DBF_ULONG",
+              ['prompt ("Max Elements in %s %02d")' % (title, j),
+               'promptgroup ("%s")' % prompt_group(base, title, j),
+               'special (SPC_NOMOD)',
+               'interest (1)',
+               'initial ("1")'])
+
+    for j in range(MaxFields):
+        field("%s%02d" % (number_name, j), "DBF_ULONG",
+              ['prompt ("Elements in %s %02d")' % (title, j),
+               'special (SPC_NOMOD)',
+               'interest (3)'])
+
+    for j in range(MaxFields):
+        field("%s%02d" % (value_name, j), "DBF_NOACCESS",
+              ['prompt ("%s %02d")' % (title, j),
+               'special (SPC_DBADDR)',
+               'extra ("void *%s%02d")' % (value_name.lower(), j)])
+
+
+# ------------------------------------------------------------------------------
+#
+def generate():
+    """ Returns the record type definition text. """
+    lines = []
+    field_group(lines, "Input", 40, "IN", "DBF_INLINK", "FI", "NI", "EI", "I")
+    field_group(lines, "Output", 50, "OU", "DBF_OUTLINK", "FO", "NO", "EO", "O")
+    return Header + "\n".join(lines) + "\n" + Footer
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    text = generate()
+    if len(sys.argv) > 1:
+        with open(sys.argv[1], "w") as f:
+            f.write(text)
+    else:
+        sys.stdout.write(text)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# end
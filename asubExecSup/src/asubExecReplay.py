@@ -0,0 +1,201 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecReplay.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Description
+# Replays input frames captured by an IOC (see asubExecCaptureStart) against an
+# EXEC, either at a chosen rate or as fast as possible, validating the outputs
+# against the captured responses and reporting latency percentiles. This gives
+# a reproducible offline benchmark of a production workload.
+#
+# Copyright (c) 2026 Australian Synchrotron
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# Licence as published by the Free Software Foundation; either
+# version 2.1 of the Licence, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public Licence for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# Licence along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+# Contact details:
+# as-open-source@ansto.gov.au
+# 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+#
+
+"""
+Replays captured asubExec frames against an EXEC.
+
+usage: asubExecReplay.py [-r record] [--rate Hz] [--repeat N] [--no-validate]
+                         capture_file exec [args ...]
+"""
+
+import argparse
+import struct
+import subprocess
+import sys
+import time
+
+# Must be consistant with asubExecCapture.h
+#
+HeaderFormat = "=8sII"
+EntryFormat = "=64sQQiIII"
+Magic = b"asubCap1"
+
+
+# ------------------------------------------------------------------------------
+#
+def read_capture(filename):
+    """ Returns a list of captured entry dictionaries. """
+    with open(filename, "rb") as f:
+        data = f.read()
+
+    header_size = struct.calcsize(HeaderFormat)
+    magic, version, entry_size = struct.unpack_from(HeaderFormat, data, 0)
+    if magic != Magic:
+        raise ValueError("%s is not an asubExec capture file" % filename)
+
+    entries = []
+    offset = header_size
+    while offset + entry_size <= len(data):
+        (record, queued, latency, exit_code, flags,
+         input_size, output_size) = struct.unpack_from(EntryFormat, data, offset)
+        offset += entry_size
+
+        frame = data[offset:offset + input_size]
+        offset += input_size
+        response = data[offset:offset + output_size]
+        offset += output_size
+
+        if len(response) != output_size:
+            break    # truncated file - capture still in progress
+
+        entries.append({'record': record.partition(b"\0")[0].decode("utf8", errors="replace"),
+                        'queued': queued,
+                        'latency': latency / 1.0e9,
+                        'exit_code': exit_code,
+                        'flags': flags,
+                        'input': frame,
+                        'output': response})
+    return entries
+
+
+# ------------------------------------------------------------------------------
+#
+def percentile(values, q):
+    """ Nearest rank percentile of a sorted list """
+    if not values:
+        return float("nan")
+    index = min(len(values) - 1, max(0, int(round(q * len(values) + 0.5)) - 1))
+    return values[index]
+
+
+# ------------------------------------------------------------------------------
+#
+def report(title, latencies):
+    values = sorted(latencies)
+    if not values:
+        print("%-10s no executions" % title)
+        return
+    print("%-10s n=%-6d mean=%8.3f  p50=%8.3f  p90=%8.3f  p99=%8.3f  max=%8.3f mSec" %
+          (title, len(values), 1.0e3 * sum(values) / len(values),
+           1.0e3 * percentile(values, 0.50), 1.0e3 * percentile(values, 0.90),
+           1.0e3 * percentile(values, 0.99), 1.0e3 * values[-1]))
+
+
+# ------------------------------------------------------------------------------
+#
+def replay(entry, command, timeout):
+    """ Runs one execution. Returns (latency, exit_code, output). """
+    start = time.perf_counter()
+    proc = subprocess.Popen(command, stdin=subprocess.PIPE, stdout=subprocess.PIPE)
+    try:
+        output, _ = proc.communicate(entry['input'], timeout=timeout)
+    except subprocess.TimeoutExpired:
+        proc.kill()
+        output, _ = proc.communicate()
+    latency = time.perf_counter() - start
+    return latency, proc.returncode, output
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    parser = argparse.ArgumentParser(description="Replays captured asubExec frames")
+    parser.add_argument("-r", "--record", default=None,
+                        help="only replay executions of this record")
+    parser.add_argument("--rate", type=float, default=0.0,
+                        help="executions per second, 0 for as fast as possible (default)")
+    parser.add_argument("--repeat", type=int, default=1,
+                        help="number of times to replay the capture")
+    parser.add_argument("--timeout", type=float, default=60.0,
+                        help="per execution timeout in seconds")
+    parser.add_argument("--no-validate", action="store_true",
+                        help="do not compare outputs with the captured responses")
+    parser.add_argument("capture_file")
+    parser.add_argument("exec")
+    parser.add_argument("args", nargs="*",
+                        help="process arguments, by default ARG1 is the record name")
+    args = parser.parse_args()
+
+    entries = read_capture(args.capture_file)
+    if args.record is not None:
+        entries = [e for e in entries if e['record'] == args.record]
+
+    if not entries:
+        print("no executions to replay")
+        return 1
+
+    period = 1.0 / args.rate if args.rate > 0.0 else 0.0
+
+    latencies = []
+    mismatches = 0
+    failures = 0
+    next_time = time.perf_counter()
+
+    for n in range(args.repeat):
+        for entry in entries:
+            if period > 0.0:
+                delay = next_time - time.perf_counter()
+                if delay > 0.0:
+                    time.sleep(delay)
+                next_time += period
+
+            command = [args.exec] + (args.args if args.args else [entry['record']])
+            latency, exit_code, output = replay(entry, command, args.timeout)
+            latencies.append(latency)
+
+            if exit_code != entry['exit_code']:
+                failures += 1
+
+            if not args.no_validate and output != entry['output']:
+                mismatches += 1
+                if mismatches == 1:
+                    limit = min(len(output), len(entry['output']))
+                    offset = next((j for j in range(limit)
+                                   if output[j] != entry['output'][j]), limit)
+                    print("first mismatch: %s, output differs at byte %d (%d vs %d bytes)" %
+                          (entry['record'], offset, len(output), len(entry['output'])))
+
+    print("replayed %d executions, %d exit code mismatches, %d output mismatches%s" %
+          (len(latencies), failures, mismatches,
+           " (not validated)" if args.no_validate else ""))
+    report("captured", [e['latency'] for e in entries])
+    report("replayed", latencies)
+
+    return 0 if (failures == 0 and mismatches == 0) else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# end
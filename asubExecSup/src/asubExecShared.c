@@ -0,0 +1,254 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecShared.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Singleflight - de-duplication of identical concurrent executions.
+ *
+ * In-flight calls are held in a list, protected by a single lock, and keyed by
+ * a hash of the argv and input frame, confirmed by a full comparison. A call is
+ * removed from the list when the leader completes, and freed once the leader
+ * and all followers have released it.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include "asubExecShared.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <cantProceed.h>
+#include <ellLib.h>
+#include <epicsMutex.h>
+#include <epicsThread.h>
+
+struct asubExecSharedCall {
+   ELLNODE node;                       /* must be first */
+   epicsUInt64 hash;
+   const char* const* argv;            /* the leader's */
+   const asubExecBuffer* input;        /* the leader's, valid until complete */
+   ELLLIST waiters;
+   int references;                     /* leader and followers */
+   bool complete;
+   asubExecBlob* response;             /* shared by the leader and followers */
+   asubExecStatus status;
+   int exitCode;
+};
+
+static epicsMutexId sharedLock = NULL;
+static epicsThreadOnceId sharedOnce = EPICS_THREAD_ONCE_INIT;
+static ELLLIST inFlight = ELLLIST_INIT;
+
+
+/*------------------------------------------------------------------------------
+ */
+static void sharedInit (void* arg)
+{
+   sharedLock = epicsMutexMustCreate ();
+}
+
+/*------------------------------------------------------------------------------
+ * FNV-1a
+ */
+static epicsUInt64 hashBytes (epicsUInt64 hash, const void* data, const size_t size)
+{
+   const epicsUInt8* p = (const epicsUInt8*) data;
+   size_t j;
+
+   for (j = 0; j < size; j++) {
+      hash ^= p [j];
+      hash *= 0x100000001b3ULL;
+   }
+   return hash;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static epicsUInt64 hashCall (const char* const argv[], const asubExecBuffer* input)
+{
+   epicsUInt64 hash = 0xcbf29ce484222325ULL;
+   int j;
+
+   for (j = 0; argv [j]; j++) {
+      hash = hashBytes (hash, argv [j], strlen (argv [j]) + 1);
+   }
+   return hashBytes (hash, input->data, input->size);
+}
+
+/*------------------------------------------------------------------------------
+ */
+static bool sameCall (const asubExecSharedCall* call, const char* const argv[],
+                      const asubExecBuffer* input)
+{
+   int j;
+
+   if (call->input->size != input->size) return false;
+
+   for (j = 0; argv [j] || call->argv [j]; j++) {
+      if (!argv [j] || !call->argv [j]) return false;
+      if (strcmp (argv [j], call->argv [j]) != 0) return false;
+   }
+
+   return memcmp (call->input->data, input->data, input->size) == 0;
+}
+
+/*------------------------------------------------------------------------------
+ * Called with the lock held.
+ */
+static void release (asubExecSharedCall* call)
+{
+   call->references--;
+   if (call->references == 0) {
+      asubExecBlobRelease (call->response);
+      free (call);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecSharedCall* asubExecSharedJoin (const char* const argv[],
+                                        const asubExecBuffer* input,
+                                        asubExecSharedWaiter* waiter, bool* leader)
+{
+   const epicsUInt64 hash = hashCall (argv, input);
+   asubExecSharedCall* call;
+
+   epicsThreadOnce (&sharedOnce, sharedInit, NULL);
+
+   epicsMutexMustLock (sharedLock);
+
+   call = (asubExecSharedCall*) ellFirst (&inFlight);
+   while (call) {
+      if (call->hash == hash && sameCall (call, argv, input)) break;
+      call = (asubExecSharedCall*) ellNext (&call->node);
+   }
+
+   if (call) {
+      ellAdd (&call->waiters, &waiter->node);
+      call->references++;
+      *leader = false;
+   } else {
+      call = (asubExecSharedCall*) callocMustSucceed (1, sizeof (asubExecSharedCall),
+                                                     "asubExecSharedJoin");
+      call->hash = hash;
+      call->argv = argv;
+      call->input = input;
+      call->references = 1;
+      ellAdd (&inFlight, &call->node);
+      *leader = true;
+   }
+
+   epicsMutexUnlock (sharedLock);
+
+   return call;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecBlob* asubExecSharedComplete (asubExecSharedCall* call, asubExecBuffer* response,
+                                      const asubExecStatus status, const int exitCode)
+{
+   asubExecBlob* shared = NULL;
+   asubExecSharedWaiter* waiter;
+
+   epicsMutexMustLock (sharedLock);
+
+   ellDelete (&inFlight, &call->node);
+   call->input = NULL;
+
+   /* Only share the response if someone is waiting for it. The response is
+    * not copied - the blob takes over the leader's buffer.
+    */
+   call->status = status;
+   if (status == asubExecOkay && ellCount (&call->waiters) > 0) {
+      call->response = asubExecBlobAdopt (response);
+      if (call->response) {
+         shared = asubExecBlobRetain (call->response);
+      } else {
+         call->status = asubExecNoMemory;
+      }
+   }
+   call->exitCode = exitCode;
+   call->complete = true;
+
+   waiter = (asubExecSharedWaiter*) ellFirst (&call->waiters);
+   while (waiter) {
+      epicsEventSignal (waiter->wake);
+      waiter = (asubExecSharedWaiter*) ellNext (&waiter->node);
+   }
+
+   release (call);
+
+   epicsMutexUnlock (sharedLock);
+
+   return shared;
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStatus asubExecSharedWait (asubExecSharedCall* call, asubExecSharedWaiter* waiter,
+                                   const double timeout,
+                                   asubExecBlob** response, int* exitCode)
+{
+   asubExecDeadline deadline;
+   asubExecStatus status;
+
+   asubExecDeadlineSet (&deadline, timeout);
+
+   epicsMutexMustLock (sharedLock);
+
+   while (!call->complete) {
+      const double remaining = asubExecDeadlineRemaining (&deadline);
+      if (remaining <= 0.0) break;
+
+      epicsMutexUnlock (sharedLock);
+      epicsEventWaitWithTimeout (waiter->wake, remaining);
+      epicsMutexMustLock (sharedLock);
+   }
+
+   /* Remove our waiter - whether complete or timed out.
+    */
+   ellDelete (&call->waiters, &waiter->node);
+
+   *response = NULL;
+   if (call->complete) {
+      status = call->status;
+      *exitCode = call->exitCode;
+      if (status == asubExecOkay) *response = asubExecBlobRetain (call->response);
+   } else {
+      status = asubExecTimedOut;
+      *exitCode = asubExecExitTimeout;
+   }
+
+   release (call);
+
+   epicsMutexUnlock (sharedLock);
+
+   return status;
+}
+
+/* end */
@@ -0,0 +1,97 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecShared.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Singleflight - de-duplication of identical concurrent executions.
+ *
+ * When a record with info (SINGLEFLIGHT, "true") is about to execute, and another
+ * such record is already executing the same argv with an identical input frame,
+ * the later record does not start its own child process but waits for, and
+ * then decodes, the response of the execution already in flight. Nothing is
+ * retained once an execution completes - this is not a cache.
+ * The response is not copied per follower: it is held in one reference counted
+ * blob, decoded in place by the leader and every follower, and freed once the
+ * last of them has finished with it.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_SHARED_H
+#define ASUB_EXEC_SHARED_H 1
+
+#include <stdbool.h>
+#include <ellLib.h>
+#include <epicsEvent.h>
+#include "asubExecCore.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct asubExecSharedCall asubExecSharedCall;
+
+/* A follower's place in a call's list of waiters, provided by the caller (e.g.
+ * on its stack) and in use from asubExecSharedJoin until asubExecSharedWait
+ * returns. No allocation is made for followers.
+ */
+typedef struct asubExecSharedWaiter {
+   ELLNODE node;                       /* must be first */
+   epicsEventId wake;                  /* set by the caller */
+} asubExecSharedWaiter;
+
+/* Joins the in-flight call with the same argv and input frame, or if there is
+ * none, creates one, in which case leader is set true. A follower's waiter's
+ * wake event is signalled when the call completes.
+ * The argv and input must remain unchanged until the leader completes.
+ */
+asubExecSharedCall* asubExecSharedJoin (const char* const argv[],
+                                        const asubExecBuffer* input,
+                                        asubExecSharedWaiter* waiter, bool* leader);
+
+/* Leader only - publishes the response, status and exit code to the followers,
+ * and releases the call. If there are followers, the response buffer is taken
+ * over by a shared blob, and the leader's reference to it is returned (to be
+ * released once decoded), otherwise NULL is returned and response is unchanged.
+ */
+asubExecBlob* asubExecSharedComplete (asubExecSharedCall* call, asubExecBuffer* response,
+                                      const asubExecStatus status, const int exitCode);
+
+/* Follower only - waits up to timeout seconds, using the waiter passed to
+ * asubExecSharedJoin, for the leader to complete, sets response to a reference
+ * to the shared response (to be released once decoded), and releases the call.
+ * Returns asubExecTimedOut on timeout, otherwise the leader's status. Response
+ * is NULL unless the status is asubExecOkay.
+ */
+asubExecStatus asubExecSharedWait (asubExecSharedCall* call, asubExecSharedWaiter* waiter,
+                                   const double timeout,
+                                   asubExecBlob** response, int* exitCode);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_SHARED_H */
@@ -0,0 +1,471 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecSim.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Description
+# Discrete event capacity simulator for asubExec workloads. Given a record
+# inventory (scan periods, field sizes, backends, modes and execution time
+# distributions, the latter optionally taken from a metrics file or a capture
+# file) and the host (number of CPUs, process creation costs), predicts the
+# execution latencies, waits due to CPU contention, utilisation, skipped scans
+# and deadline misses, before the records are deployed.
+#
+# Copyright (c) 2026 Australian Synchrotron
+#
+# This library is free software; you can redistribute it and/or
+# modify it under the terms of the GNU Lesser General Public
+# Licence as published by the Free Software Foundation; either
+# version 2.1 of the Licence, or (at your option) any later version.
+#
+# This library is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+# Lesser General Public Licence for more details.
+#
+# You should have received a copy of the GNU Lesser General Public
+# Licence along with this library; if not, write to the Free Software
+# Foundation, Inc., 51 Franklin St, Fifth Floor, Boston, MA 02110-1301 USA.
+#
+# Contact details:
+# as-open-source@ansto.gov.au
+# 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+#
+
+"""
+Predicts whether an IOC will keep up with a set of asubExec records.
+
+usage: asubExecSim.py [--duration s] [--seed n] [--cpus n] [--compare metrics_file]
+                      inventory.json
+
+The inventory is a JSON file, e.g.
+
+{
+  "host": { "cpus": 4, "fork": 0.002, "posix_spawn": 0.0005, "bandwidth": 1.0e9 },
+  "records": [
+    { "name": "MIDPT:FAST", "count": 20, "scan": 0.1, "phase": 0.0,
+      "backend": "posix_spawn", "mode": "oneshot", "bytes": 80000,
+      "work": { "lognormal": [0.004, 0.3] }, "deadline": 0.1 },
+    { "name": "MIDPT:ASUB:EXEC", "scan": 1.0,
+      "work": { "metrics": "/run/node_exporter/myioc_asubexec.prom" } },
+    { "name": "MIDPT:SLOW", "scan": 10.0,
+      "work": { "capture": "/tmp/myioc.asubExec.cap", "record": "MIDPT:SLOW" } }
+  ]
+}
+
+Host, all optional:
+  cpus        - number of CPUs available to the IOC and its child processes
+  fork        - CPU seconds to create a child process using fork()
+  posix_spawn - CPU seconds to create a child process using posix_spawn()
+  bandwidth   - pipe throughput, bytes per CPU second
+
+Records, all but name and work optional:
+  name     - record name, the record number is appended if count > 1
+  count    - number of identical records (default 1)
+  scan     - scan period in seconds (default 1.0), or 0 for none
+  rate     - alternatively, the mean rate (Hz) of randomly (Poisson) processed
+             records, e.g. those processed by CP links
+  phase    - offset of the first execution within the scan period (default 0),
+             records with the same scan period are otherwise processed together
+  backend  - "fork" (default) or "posix_spawn"
+  mode     - "oneshot" (default) or "persistent", i.e. no process creation
+  bytes    - input plus output frame size (default 0)
+  work     - the CPU seconds used per execution, one of:
+               { "fixed": s }
+               { "exponential": mean }
+               { "lognormal": [median, sigma] }
+               { "metrics": file, "record": name }  latency histogram
+               { "capture": file, "record": name }  captured latencies
+             the record defaults to the record's name. Measured latencies
+             include the process creation and transfer costs, which are then
+             not added again.
+  deadline - latency beyond which an execution is deemed late (default scan)
+
+Each record executes one at a time, as does the IOC: a scan that falls due
+whilst the record is still active (pact) is skipped. The executions in progress
+share the CPUs equally (processor sharing), which is a good approximation of
+the Linux scheduler for CPU bound child processes.
+"""
+
+import argparse
+import heapq
+import json
+import math
+import random
+import re
+import struct
+import sys
+
+SampleRegex = re.compile(r'^(\w+)\{record="([^"]*)",exec="[^"]*"(?:,le="([^"]*)")?\} (\S+)$')
+
+# Must be consistant with asubExecCapture.h, as per asubExecReplay.py
+#
+CaptureHeaderFormat = "=8sII"
+CaptureEntryFormat = "=64sQQiIII"
+CaptureMagic = b"asubCap1"
+
+DefaultHost = {'cpus': 1, 'fork': 0.002, 'posix_spawn': 0.0005, 'bandwidth': 1.0e9}
+
+
+# ------------------------------------------------------------------------------
+#
+def read_histograms(filename):
+    """ Returns { record: [(le, cumulative count), ...] } of the latency
+        histograms in the metrics file (see asubExecMetricsFile).
+    """
+    histograms = {}
+    with open(filename, "r") as f:
+        for line in f:
+            match = SampleRegex.match(line.strip())
+            if match is None:
+                continue
+            name, record, le, value = match.groups()
+            if name != "asubexec_latency_seconds_bucket":
+                continue
+            limit = float("inf") if le == "+Inf" else float(le)
+            histograms.setdefault(record, []).append((limit, float(value)))
+
+    for buckets in histograms.values():
+        buckets.sort()
+    return histograms
+
+
+# ------------------------------------------------------------------------------
+#
+def read_capture_latencies(filename):
+    """ Returns { record: [latency, ...] } of the executions in the capture file
+        (see asubExecCaptureStart).
+    """
+    with open(filename, "rb") as f:
+        data = f.read()
+
+    magic, version, entry_size = struct.unpack_from(CaptureHeaderFormat, data, 0)
+    if magic != CaptureMagic:
+        raise ValueError("%s is not an asubExec capture file" % filename)
+
+    latencies = {}
+    offset = struct.calcsize(CaptureHeaderFormat)
+    while offset + entry_size <= len(data):
+        (record, queued, latency, exit_code, flags,
+         input_size, output_size) = struct.unpack_from(CaptureEntryFormat, data, offset)
+        offset += entry_size + input_size + output_size
+        if offset > len(data):
+            break    # truncated file - capture still in progress
+
+        name = record.partition(b"\0")[0].decode("utf8", errors="replace")
+        latencies.setdefault(name, []).append(latency / 1.0e9)
+
+    return latencies
+
+
+# ------------------------------------------------------------------------------
+#
+class Distribution(object):
+    """ Execution time distribution - sample() returns seconds. """
+
+    def __init__(self, spec, record, rng, cache):
+        self._rng = rng
+        self.measured = False
+
+        if "fixed" in spec:
+            value = float(spec["fixed"])
+            self.sample = lambda: value
+
+        elif "exponential" in spec:
+            mean = float(spec["exponential"])
+            self.sample = lambda: rng.expovariate(1.0 / mean) if mean > 0.0 else 0.0
+
+        elif "lognormal" in spec:
+            median, sigma = (float(v) for v in spec["lognormal"])
+            mu = math.log(median)
+            self.sample = lambda: rng.lognormvariate(mu, sigma)
+
+        elif "metrics" in spec:
+            filename = spec["metrics"]
+            if filename not in cache:
+                cache[filename] = read_histograms(filename)
+            buckets = cache[filename].get(spec.get("record", record), None)
+            if not buckets or buckets[-1][1] <= 0.0:
+                raise ValueError("%s: no latency histogram for %s" %
+                                 (filename, spec.get("record", record)))
+            self._buckets = buckets
+            self.sample = self._sample_histogram
+            self.measured = True
+
+        elif "capture" in spec:
+            filename = spec["capture"]
+            if filename not in cache:
+                cache[filename] = read_capture_latencies(filename)
+            values = cache[filename].get(spec.get("record", record), None)
+            if not values:
+                raise ValueError("%s: no executions of %s" %
+                                 (filename, spec.get("record", record)))
+            self.sample = lambda: rng.choice(values)
+            self.measured = True
+
+        else:
+            raise ValueError("%s: unknown work distribution %s" % (record, spec))
+
+    def _sample_histogram(self):
+        """ Picks a bucket as per the counts, then uniformly within the bucket. """
+        total = self._buckets[-1][1]
+        target = self._rng.random() * total
+        lower = 0.0
+        for limit, cumulative in self._buckets:
+            if target < cumulative:
+                if math.isinf(limit):
+                    return lower
+                return self._rng.uniform(lower, limit)
+            lower = limit
+        return lower
+
+
+# ------------------------------------------------------------------------------
+#
+class Record(object):
+    """ A simulated record and its statistics. """
+
+    def __init__(self, name, spec, host, rng, cache):
+        self.name = name
+        self.scan = float(spec.get("scan", 1.0))
+        self.rate = float(spec.get("rate", 0.0))
+        self.phase = float(spec.get("phase", 0.0))
+        self.deadline = float(spec.get("deadline", self.scan if self.scan > 0.0 else
+                                       (1.0 / self.rate if self.rate > 0.0 else 0.0)))
+        self.work = Distribution(spec["work"], name, rng, cache)
+
+        backend = spec.get("backend", "fork")
+        if backend not in ("fork", "posix_spawn"):
+            raise ValueError("%s: invalid backend '%s'" % (name, backend))
+
+        mode = spec.get("mode", "oneshot")
+        if mode not in ("oneshot", "persistent"):
+            raise ValueError("%s: invalid mode '%s'" % (name, mode))
+
+        # Per execution overheads - already included in measured latencies.
+        #
+        self.overhead = 0.0
+        if not self.work.measured:
+            if mode == "oneshot":
+                self.overhead += float(host[backend])
+            self.overhead += float(spec.get("bytes", 0)) / float(host["bandwidth"])
+
+        self.active = False
+        self.executions = 0
+        self.skipped = 0
+        self.late = 0
+        self.latencies = []
+        self.waits = []
+
+
+# ------------------------------------------------------------------------------
+#
+class Execution(object):
+    __slots__ = ("record", "start", "demand", "remaining")
+
+    def __init__(self, record, start, demand):
+        self.record = record
+        self.start = start
+        self.demand = demand
+        self.remaining = demand
+
+
+# ------------------------------------------------------------------------------
+#
+def simulate(records, cpus, duration, rng):
+    """ Runs the simulation, updating the records' statistics.
+        Returns (busy CPU seconds, time weighted mean concurrency, peak concurrency).
+    """
+    arrivals = []
+    for j, record in enumerate(records):
+        if record.scan > 0.0:
+            heapq.heappush(arrivals, (record.phase % record.scan, j))
+        elif record.rate > 0.0:
+            heapq.heappush(arrivals, (rng.expovariate(record.rate), j))
+
+    running = []
+    now = 0.0
+    busy = 0.0
+    area = 0.0
+    peak = 0
+
+    while True:
+        next_arrival = arrivals[0][0] if arrivals else float("inf")
+
+        # Each execution in progress gets an equal share of the CPUs, at most one.
+        #
+        share = min(1.0, cpus / len(running)) if running else 0.0
+        next_completion = float("inf")
+        if running:
+            next_completion = now + min(e.remaining for e in running) / share
+
+        end = min(next_arrival, next_completion)
+        if end > duration and not running:
+            break
+        if math.isinf(end):
+            break
+
+        dt = end - now
+        for e in running:
+            e.remaining -= dt * share
+        busy += dt * share * len(running)
+        area += dt * len(running)
+        now = end
+
+        if next_completion <= next_arrival:
+            done = [e for e in running if e.remaining <= 1.0e-12]
+            running = [e for e in running if e.remaining > 1.0e-12]
+            for e in done:
+                record = e.record
+                latency = now - e.start
+                record.active = False
+                record.executions += 1
+                record.latencies.append(latency)
+                record.waits.append(latency - e.demand)
+                if record.deadline > 0.0 and latency > record.deadline:
+                    record.late += 1
+            continue
+
+        _, j = heapq.heappop(arrivals)
+        record = records[j]
+
+        if now < duration:
+            if record.scan > 0.0:
+                heapq.heappush(arrivals, (now + record.scan, j))
+            else:
+                heapq.heappush(arrivals, (now + rng.expovariate(record.rate), j))
+
+            if record.active:
+                record.skipped += 1    # pact - the scan is lost
+            else:
+                record.active = True
+                running.append(Execution(record, now, record.overhead + record.work.sample()))
+                peak = max(peak, len(running))
+
+    return busy, (area / now if now > 0.0 else 0.0), peak
+
+
+# ------------------------------------------------------------------------------
+#
+def percentile(values, q):
+    """ Nearest rank percentile of a sorted list """
+    if not values:
+        return float("nan")
+    index = min(len(values) - 1, max(0, int(round(q * len(values) + 0.5)) - 1))
+    return values[index]
+
+
+# ------------------------------------------------------------------------------
+#
+def histogram_percentile(buckets, q):
+    """ Upper bucket limit at the given quantile of a cumulative histogram. """
+    total = buckets[-1][1] if buckets else 0.0
+    if total <= 0.0:
+        return float("nan")
+    for limit, cumulative in buckets:
+        if cumulative >= q * total:
+            return limit
+    return float("inf")
+
+
+# ------------------------------------------------------------------------------
+#
+def load_inventory(filename, cpus, rng):
+    """ Returns (host, records) """
+    with open(filename, "r") as f:
+        inventory = json.load(f)
+
+    host = dict(DefaultHost)
+    host.update(inventory.get("host", {}))
+    if cpus is not None:
+        host['cpus'] = cpus
+
+    cache = {}
+    records = []
+    for spec in inventory.get("records", []):
+        count = int(spec.get("count", 1))
+        for n in range(count):
+            name = spec["name"] if count == 1 else "%s%d" % (spec["name"], n)
+            records.append(Record(name, spec, host, rng, cache))
+
+    return host, records
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    parser = argparse.ArgumentParser(description="asubExec capacity simulator")
+    parser.add_argument("--duration", type=float, default=60.0,
+                        help="simulated time in seconds (default 60)")
+    parser.add_argument("--seed", type=int, default=1,
+                        help="random number seed, for repeatable results")
+    parser.add_argument("--cpus", type=float, default=None,
+                        help="overrides the inventory's number of CPUs")
+    parser.add_argument("--compare", default=None, metavar="metrics_file",
+                        help="compare predicted latencies with those measured")
+    parser.add_argument("inventory")
+    args = parser.parse_args()
+
+    rng = random.Random(args.seed)
+    host, records = load_inventory(args.inventory, args.cpus, rng)
+    if not records:
+        print("no records in inventory")
+        return 1
+
+    cpus = float(host['cpus'])
+    busy, concurrency, peak = simulate(records, cpus, args.duration, rng)
+
+    print("%d records, %g cpus, %g seconds simulated" % (len(records), cpus, args.duration))
+    print("utilisation %.1f%%, mean concurrency %.2f, peak concurrency %d" %
+          (100.0 * busy / (cpus * args.duration), concurrency, peak))
+    print()
+    print("%-28s %7s %7s %6s %9s %9s %9s %9s" %
+          ("record", "execs", "skipped", "late", "mean", "p50", "p99", "wait p99"))
+
+    total_skipped = 0
+    total_late = 0
+    for record in records:
+        latencies = sorted(record.latencies)
+        waits = sorted(record.waits)
+        mean = sum(latencies) / len(latencies) if latencies else float("nan")
+        print("%-28s %7d %7d %6d %9.3f %9.3f %9.3f %9.3f" %
+              (record.name, record.executions, record.skipped, record.late,
+               1.0e3 * mean, 1.0e3 * percentile(latencies, 0.50),
+               1.0e3 * percentile(latencies, 0.99), 1.0e3 * percentile(waits, 0.99)))
+        total_skipped += record.skipped
+        total_late += record.late
+
+    print("(latencies in mSec)")
+    print()
+    print("deadline misses: %d late, %d skipped scans" % (total_late, total_skipped))
+
+    # Validation - the measured latencies, e.g. of a scale test run, against
+    # those predicted for the same load.
+    #
+    if args.compare is not None:
+        histograms = read_histograms(args.compare)
+        print()
+        print("%-28s %9s %9s %9s %9s" %
+              ("record", "p50", "p50 meas", "p99", "p99 meas"))
+        for record in records:
+            buckets = histograms.get(record.name, None)
+            if not buckets:
+                continue
+            latencies = sorted(record.latencies)
+            print("%-28s %9.3f %9.3f %9.3f %9.3f" %
+                  (record.name,
+                   1.0e3 * percentile(latencies, 0.50),
+                   1.0e3 * histogram_percentile(buckets, 0.50),
+                   1.0e3 * percentile(latencies, 0.99),
+                   1.0e3 * histogram_percentile(buckets, 0.99)))
+        print("(latencies in mSec, measured values are histogram bucket limits)")
+
+    return 0 if (total_late == 0 and total_skipped == 0) else 2
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# end
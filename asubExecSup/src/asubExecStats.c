@@ -0,0 +1,539 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecStats.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * asubExec per record performance statistics - see asubExecStats.h
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include "asubExecStats.h"
+#include "asubExecCore.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cantProceed.h>
+#include <dbDefs.h>
+#include <dbScan.h>
+#include <ellLib.h>
+#include <epicsExport.h>
+#include <epicsMutex.h>
+#include <epicsString.h>
+#include <epicsThread.h>
+#include <errlog.h>
+
+static double asubExecStatsPeriod = 1.0;   /* exported to IOC shell */
+
+static ELLLIST statsList = ELLLIST_INIT;
+
+/* IOC wide executions in flight - current, peak this period, and as derived.
+ */
+static int activeExecutions = 0;
+static int activePeak = 0;
+static double concurrencyMean = 0.0;
+static double concurrencyPeak = 0.0;
+static epicsMutexId statsLock = NULL;
+static epicsThreadOnceId statsOnce = EPICS_THREAD_ONCE_INIT;
+
+static const char* metricNames [asubExecStatsMetricCount] = {
+   "executions", "failures", "timeouts", "rate",
+   "p50", "p90", "p99", "mean", "max",
+   "queue", "queue_p99", "bytes_in", "bytes_out",
+   "slo_minor", "slo_major", "deferred", "clamped", "nans",
+   "cycles", "instructions", "task_clock", "page_faults", "context_switches",
+   "exec_hits", "exec_cold_starts", "recycles",
+   "concurrency", "concurrency_peak",
+   "detached", "detached_failures", "detached_rejected"
+};
+
+static const char* histogramNames [asubExecStatsHistogramCount] = {
+   "hist", "queue_hist"
+};
+
+
+/*------------------------------------------------------------------------------
+ */
+static int bucketOf (const epicsUInt64 nSec)
+{
+   const epicsUInt64 uSec = nSec / 1000;
+   if (uSec == 0) return 0;
+   const int k = 64 - __builtin_clzll (uSec);
+   return k < asubExecStatsBuckets ? k : asubExecStatsBuckets - 1;
+}
+
+/*------------------------------------------------------------------------------
+ * Estimates the q quantile (0 .. 1) in seconds from histogram counts,
+ * interpolating linearly within the selected bucket.
+ */
+static double quantile (const epicsUInt64* counts, const double q)
+{
+   epicsUInt64 total = 0;
+   int k;
+
+   for (k = 0; k < asubExecStatsBuckets; k++) total += counts [k];
+   if (total == 0) return -1.0;
+
+   const double target = q * (double) total;
+   double cumulative = 0.0;
+
+   for (k = 0; k < asubExecStatsBuckets; k++) {
+      if (counts [k] == 0) continue;
+      if (cumulative + (double) counts [k] >= target) {
+         const double lower = k == 0 ? 0.0 : (double) (1ULL << (k - 1));
+         const double upper = (double) (1ULL << k);
+         const double fraction = (target - cumulative) / (double) counts [k];
+         return (lower + fraction * (upper - lower)) * 1.0e-6;
+      }
+      cumulative += (double) counts [k];
+   }
+   return (double) (1ULL << (asubExecStatsBuckets - 1)) * 1.0e-6;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsSnapshot (const asubExecStats* stats, asubExecStatsCounters* counters)
+{
+   const epicsUInt64* source = (const epicsUInt64*) &stats->counters;
+   epicsUInt64* target = (epicsUInt64*) counters;
+   size_t j;
+
+   for (j = 0; j < sizeof (asubExecStatsCounters) / sizeof (epicsUInt64); j++) {
+      target [j] = __atomic_load_n (&source [j], __ATOMIC_RELAXED);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+double asubExecStatsBucketLimit (const int k)
+{
+   if (k >= asubExecStatsBuckets - 1) return HUGE_VAL;
+   return (double) (1ULL << k) * 1.0e-6;
+}
+
+/*------------------------------------------------------------------------------
+ * Derive period values. Called with the lock held.
+ * Percentiles and means are over the last period, and are held when there
+ * were no executions during the period.
+ * Returns the total latency (nSec) of the executions during the period.
+ */
+static epicsUInt64 derive (asubExecStats* stats, const double period)
+{
+   asubExecStatsCounters now;
+   asubExecStatsCounters* prev = &stats->previous;
+   epicsUInt64 delta [asubExecStatsBuckets];
+   double* derived = stats->derived;
+   int k;
+
+   asubExecStatsSnapshot (stats, &now);
+
+   const epicsUInt64 executions = now.executions - prev->executions;
+   const epicsUInt64 latency = now.latencySum - prev->latencySum;
+
+   derived [asubExecStatsExecutions] = (double) now.executions;
+   derived [asubExecStatsFailures] = (double) now.failures;
+   derived [asubExecStatsTimeouts] = (double) now.timeouts;
+   derived [asubExecStatsRate] = (double) executions / period;
+   derived [asubExecStatsMax] = (double) now.latencyMax * 1.0e-9;
+   derived [asubExecStatsBytesIn] = (double) now.bytesIn;
+   derived [asubExecStatsBytesOut] = (double) now.bytesOut;
+   derived [asubExecStatsSloMinor] = (double) now.sloMinor;
+   derived [asubExecStatsSloMajor] = (double) now.sloMajor;
+   derived [asubExecStatsDeferred] = (double) now.deferred;
+   derived [asubExecStatsClamped] = (double) now.clamped;
+   derived [asubExecStatsNans] = (double) now.nans;
+   derived [asubExecStatsExecHits] = (double) now.execHits;
+   derived [asubExecStatsExecColdStarts] = (double) now.execColdStarts;
+   derived [asubExecStatsRecycles] = (double) now.recycles;
+   derived [asubExecStatsDetached] = (double) now.detached;
+   derived [asubExecStatsDetachedFailures] = (double) now.detachedFailures;
+   derived [asubExecStatsDetachedRejected] = (double) now.detachedRejected;
+
+   /* The perf metrics are in asubExecPerfCounter order.
+    */
+   const epicsUInt64 perfExecutions = now.perfExecutions - prev->perfExecutions;
+   if (perfExecutions > 0) {
+      for (k = 0; k < asubExecPerfCount; k++) {
+         derived [asubExecStatsCycles + k] =
+             (double) (now.perf [k] - prev->perf [k]) / (double) perfExecutions;
+      }
+      derived [asubExecStatsTaskClock] *= 1.0e-9;
+   }
+
+   if (executions > 0) {
+      for (k = 0; k < asubExecStatsBuckets; k++) {
+         delta [k] = now.hist [asubExecStatsLatencyHist][k] -
+                     prev->hist [asubExecStatsLatencyHist][k];
+      }
+      derived [asubExecStatsP50] = quantile (delta, 0.50);
+      derived [asubExecStatsP90] = quantile (delta, 0.90);
+      derived [asubExecStatsP99] = quantile (delta, 0.99);
+      derived [asubExecStatsMean] = (double) latency * 1.0e-9 / (double) executions;
+
+      for (k = 0; k < asubExecStatsBuckets; k++) {
+         delta [k] = now.hist [asubExecStatsQueueHist][k] -
+                     prev->hist [asubExecStatsQueueHist][k];
+      }
+      derived [asubExecStatsQueueP99] = quantile (delta, 0.99);
+      derived [asubExecStatsQueue] =
+          (double) (now.queueSum - prev->queueSum) * 1.0e-9 / (double) executions;
+   }
+
+   *prev = now;
+   return latency;
+}
+
+/*------------------------------------------------------------------------------
+ * Stats thread - derive values and request I/O Intr processing each period.
+ * Rates are over the measured elapsed time, as the thread may wake up late.
+ */
+static void statsThread (void* arg)
+{
+   IOSCANPVT* ioscans = NULL;     /* snapshot of the list's ioscans */
+   int capacity = 0;
+   uint64_t previous = asubExecMonotonicNow ();
+   int j;
+
+   while (true) {
+      epicsThreadSleep (asubExecStatsPeriod >= 0.1 ? asubExecStatsPeriod : 0.1);
+
+      const uint64_t now = asubExecMonotonicNow ();
+      const double period = now > previous ? (double) (now - previous) * 1.0e-9 : 1.0e-9;
+      previous = now;
+
+      /* The mean concurrency is, as per Little's law, the total latency of
+       * the executions during the period over the period.
+       */
+      epicsUInt64 latency = 0;
+
+      epicsMutexMustLock (statsLock);
+
+      const int count = ellCount (&statsList);
+      if (count > capacity) {
+         free (ioscans);
+         capacity = count + 16;
+         ioscans = (IOSCANPVT*) callocMustSucceed (capacity, sizeof (IOSCANPVT),
+                                                   "asubExecStats");
+      }
+
+      asubExecStats* stats = (asubExecStats*) ellFirst (&statsList);
+      while (stats) {
+         latency += derive (stats, period);
+         stats = (asubExecStats*) ellNext (&stats->node);
+      }
+
+      /* The peak restarts from the executions currently in flight.
+       */
+      const int active = __atomic_load_n (&activeExecutions, __ATOMIC_RELAXED);
+      concurrencyMean = (double) latency * 1.0e-9 / period;
+      concurrencyPeak = (double) __atomic_exchange_n (&activePeak, active, __ATOMIC_RELAXED);
+
+      j = 0;
+      stats = (asubExecStats*) ellFirst (&statsList);
+      while (stats) {
+         stats->derived [asubExecStatsConcurrency] = concurrencyMean;
+         stats->derived [asubExecStatsConcurrencyPeak] = concurrencyPeak;
+         ioscans [j++] = stats->ioscan;
+         stats = (asubExecStats*) ellNext (&stats->node);
+      }
+      epicsMutexUnlock (statsLock);
+
+      /* Outside of the lock - the records read the values under lock.
+       */
+      for (j = 0; j < count; j++) {
+         scanIoRequest (ioscans [j]);
+      }
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+static void statsInit (void* arg)
+{
+   statsLock = epicsMutexMustCreate ();
+   epicsThreadMustCreate ("asubExecStats", epicsThreadPriorityLow,
+                          epicsThreadGetStackSize (epicsThreadStackSmall),
+                          statsThread, NULL);
+}
+
+/*------------------------------------------------------------------------------
+ */
+asubExecStats* asubExecStatsAttach (const char* recordName, const char* exec)
+{
+   asubExecStats* stats;
+
+   epicsThreadOnce (&statsOnce, statsInit, NULL);
+
+   epicsMutexMustLock (statsLock);
+
+   stats = (asubExecStats*) ellFirst (&statsList);
+   while (stats) {
+      if (strcmp (stats->recordName, recordName) == 0) break;
+      stats = (asubExecStats*) ellNext (&stats->node);
+   }
+
+   if (!stats) {
+      stats = (asubExecStats*) callocMustSucceed (1, sizeof (asubExecStats),
+                                                  "asubExecStatsAttach");
+      stats->recordName = epicsStrDup (recordName);
+      scanIoInit (&stats->ioscan);
+      ellAdd (&statsList, &stats->node);
+   }
+
+   if (exec && !stats->exec) {
+      stats->exec = epicsStrDup (exec);
+   }
+
+   epicsMutexUnlock (statsLock);
+
+   return stats;
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsIterate (asubExecStatsIterator func, void* context)
+{
+   epicsThreadOnce (&statsOnce, statsInit, NULL);
+
+   epicsMutexMustLock (statsLock);
+   asubExecStats* stats = (asubExecStats*) ellFirst (&statsList);
+   while (stats) {
+      func (stats, context);
+      stats = (asubExecStats*) ellNext (&stats->node);
+   }
+   epicsMutexUnlock (statsLock);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsUpdate (asubExecStats* stats, const asubExecTrace* trace)
+{
+   if (!stats) return;
+
+   asubExecStatsCounters* c = &stats->counters;
+   const epicsUInt64 queued = trace->time [asubExecPhaseQueued];
+   const epicsUInt64 started = trace->time [asubExecPhaseStart];
+   const epicsUInt64 reaped = trace->time [asubExecPhaseReaped];
+   const epicsUInt64 latency = (queued && reaped > queued) ? reaped - queued : 0;
+   const epicsUInt64 queue = (queued && started > queued) ? started - queued : 0;
+
+   __atomic_fetch_add (&c->executions, 1, __ATOMIC_RELAXED);
+   if (trace->flags & asubExecTraceFailed)
+      __atomic_fetch_add (&c->failures, 1, __ATOMIC_RELAXED);
+   if (trace->flags & asubExecTraceTimeout)
+      __atomic_fetch_add (&c->timeouts, 1, __ATOMIC_RELAXED);
+   if (trace->flags & asubExecTraceLatencyMinor)
+      __atomic_fetch_add (&c->sloMinor, 1, __ATOMIC_RELAXED);
+   if (trace->flags & asubExecTraceLatencyMajor)
+      __atomic_fetch_add (&c->sloMajor, 1, __ATOMIC_RELAXED);
+
+   __atomic_fetch_add (&c->bytesIn, trace->bytesIn, __ATOMIC_RELAXED);
+   __atomic_fetch_add (&c->bytesOut, trace->bytesOut, __ATOMIC_RELAXED);
+   __atomic_fetch_add (&c->latencySum, latency, __ATOMIC_RELAXED);
+   __atomic_fetch_add (&c->queueSum, queue, __ATOMIC_RELAXED);
+   __atomic_fetch_add (&c->hist [asubExecStatsLatencyHist][bucketOf (latency)], 1,
+                       __ATOMIC_RELAXED);
+   __atomic_fetch_add (&c->hist [asubExecStatsQueueHist][bucketOf (queue)], 1,
+                       __ATOMIC_RELAXED);
+
+   /* Single writer per record, so a plain compare is sufficient.
+    */
+   if (latency > __atomic_load_n (&c->latencyMax, __ATOMIC_RELAXED))
+      __atomic_store_n (&c->latencyMax, latency, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsDefer (asubExecStats* stats)
+{
+   if (!stats) return;
+   __atomic_fetch_add (&stats->counters.deferred, 1, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsTransform (asubExecStats* stats, const epicsUInt64 clamped,
+                             const epicsUInt64 nans)
+{
+   if (!stats) return;
+   if (clamped) __atomic_fetch_add (&stats->counters.clamped, clamped, __ATOMIC_RELAXED);
+   if (nans) __atomic_fetch_add (&stats->counters.nans, nans, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsPerf (asubExecStats* stats, const uint64_t values[asubExecPerfCount])
+{
+   int k;
+
+   if (!stats) return;
+   for (k = 0; k < asubExecPerfCount; k++) {
+      __atomic_fetch_add (&stats->counters.perf [k], values [k], __ATOMIC_RELAXED);
+   }
+   __atomic_fetch_add (&stats->counters.perfExecutions, 1, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsExecCache (asubExecStats* stats, const bool hit)
+{
+   if (!stats) return;
+   if (hit) {
+      __atomic_fetch_add (&stats->counters.execHits, 1, __ATOMIC_RELAXED);
+   } else {
+      __atomic_fetch_add (&stats->counters.execColdStarts, 1, __ATOMIC_RELAXED);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsRecycle (asubExecStats* stats)
+{
+   if (!stats) return;
+   __atomic_fetch_add (&stats->counters.recycles, 1, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsDetach (asubExecStats* stats, const bool rejected)
+{
+   if (!stats) return;
+   if (rejected) {
+      __atomic_fetch_add (&stats->counters.detachedRejected, 1, __ATOMIC_RELAXED);
+   } else {
+      __atomic_fetch_add (&stats->counters.detached, 1, __ATOMIC_RELAXED);
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsDetachedFailure (asubExecStats* stats)
+{
+   if (!stats) return;
+   __atomic_fetch_add (&stats->counters.detachedFailures, 1, __ATOMIC_RELAXED);
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsActive (const bool start)
+{
+   if (!start) {
+      __atomic_fetch_sub (&activeExecutions, 1, __ATOMIC_RELAXED);
+      return;
+   }
+
+   const int active = __atomic_add_fetch (&activeExecutions, 1, __ATOMIC_RELAXED);
+   int peak = __atomic_load_n (&activePeak, __ATOMIC_RELAXED);
+   while (active > peak &&
+          !__atomic_compare_exchange_n (&activePeak, &peak, active, true,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+      /* peak updated by the failed exchange */
+   }
+}
+
+/*------------------------------------------------------------------------------
+ */
+void asubExecStatsConcurrencyValues (double* mean, double* peak)
+{
+   epicsThreadOnce (&statsOnce, statsInit, NULL);
+
+   epicsMutexMustLock (statsLock);
+   *mean = concurrencyMean;
+   *peak = concurrencyPeak;
+   epicsMutexUnlock (statsLock);
+}
+
+/*------------------------------------------------------------------------------
+ */
+double asubExecStatsValue (asubExecStats* stats, const asubExecStatsMetric metric)
+{
+   double result;
+
+   if (!stats || metric < 0 || metric >= asubExecStatsMetricCount) return 0.0;
+
+   epicsMutexMustLock (statsLock);
+   result = stats->derived [metric];
+   epicsMutexUnlock (statsLock);
+
+   return result;
+}
+
+/*------------------------------------------------------------------------------
+ */
+int asubExecStatsHistogramValues (asubExecStats* stats, const asubExecStatsHistogram which,
+                                  double* values, const int number)
+{
+   int n = number < asubExecStatsBuckets ? number : asubExecStatsBuckets;
+   int k;
+
+   if (!stats || which < 0 || which >= asubExecStatsHistogramCount) return 0;
+
+   epicsMutexMustLock (statsLock);
+   for (k = 0; k < n; k++) {
+      values [k] = (double) stats->previous.hist [which][k];
+   }
+   epicsMutexUnlock (statsLock);
+
+   return n;
+}
+
+/*------------------------------------------------------------------------------
+ */
+int asubExecStatsMetricByName (const char* name)
+{
+   int j;
+   for (j = 0; j < asubExecStatsMetricCount; j++) {
+      if (strcmp (name, metricNames [j]) == 0) return j;
+   }
+   return -1;
+}
+
+int asubExecStatsHistogramByName (const char* name)
+{
+   int j;
+   for (j = 0; j < asubExecStatsHistogramCount; j++) {
+      if (strcmp (name, histogramNames [j]) == 0) return j;
+   }
+   return -1;
+}
+
+const char* asubExecStatsMetricName (const asubExecStatsMetric metric)
+{
+   if (metric < 0 || metric >= asubExecStatsMetricCount) return "";
+   return metricNames [metric];
+}
+
+/* -----------------------------------------------------------------------------
+ */
+epicsExportAddress (double, asubExecStatsPeriod);
+
+/* end */
@@ -0,0 +1,223 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecStats.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * asubExec per record performance statistics.
+ *
+ * Counters and latency histograms are updated by each record's execute thread
+ * using relaxed atomic operations - no locks are taken on the hot path.
+ * A background thread periodically (asubExecStatsPeriod seconds) derives the
+ * rate, percentile and mean values and requests I/O Intr processing of any
+ * records reading the statistics via the "asubExec Stats" device support.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_STATS_H
+#define ASUB_EXEC_STATS_H 1
+
+#include <ellLib.h>
+#include <dbScan.h>
+#include <epicsTypes.h>
+#include "asubExecPerf.h"
+#include "asubExecTrace.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Histogram bucket k counts values in the range [2^(k-1), 2^k) uSec, with
+ * bucket 0 counting values less than 1 uSec. The last bucket also counts all
+ * larger values.
+ */
+#define asubExecStatsBuckets  32
+
+typedef enum asubExecStatsMetric {
+   asubExecStatsExecutions = 0,        /* total executions */
+   asubExecStatsFailures,              /* total failed executions */
+   asubExecStatsTimeouts,              /* total timed out executions */
+   asubExecStatsRate,                  /* executions per second */
+   asubExecStatsP50,                   /* latency 50th percentile (s) */
+   asubExecStatsP90,                   /* latency 90th percentile (s) */
+   asubExecStatsP99,                   /* latency 99th percentile (s) */
+   asubExecStatsMean,                  /* latency mean (s) */
+   asubExecStatsMax,                   /* latency maximum (s) since IOC start */
+   asubExecStatsQueue,                 /* queue wait mean (s) */
+   asubExecStatsQueueP99,              /* queue wait 99th percentile (s) */
+   asubExecStatsBytesIn,               /* total bytes written to child processes */
+   asubExecStatsBytesOut,              /* total bytes read from child processes */
+   asubExecStatsSloMinor,              /* total LATENCY_MINOR breaches */
+   asubExecStatsSloMajor,              /* total LATENCY_MAJOR breaches */
+   asubExecStatsDeferred,              /* total requests deferred by MAXRATE */
+   asubExecStatsClamped,               /* total output elements clamped by POST_x */
+   asubExecStatsNans,                  /* total NaN output elements seen by POST_x */
+   asubExecStatsCycles,                /* perf counter means per execution, over */
+   asubExecStatsInstructions,          /* the last period, see info (PERF, ...) */
+   asubExecStatsTaskClock,             /* (s) */
+   asubExecStatsPageFaults,
+   asubExecStatsContextSwitches,
+   asubExecStatsExecHits,              /* total EXECLINK program cache hits */
+   asubExecStatsExecColdStarts,        /* total EXECLINK program resolutions */
+   asubExecStatsRecycles,              /* total persistent workers recycled */
+   asubExecStatsConcurrency,           /* IOC wide mean executions in flight, */
+   asubExecStatsConcurrencyPeak,       /* and peak, over the last period */
+   asubExecStatsDetached,              /* total detached children started */
+   asubExecStatsDetachedFailures,      /* total detached children failed/timed out */
+   asubExecStatsDetachedRejected,      /* total requests over the DETACHED_MAX limit */
+   asubExecStatsMetricCount            /* Must be last */
+} asubExecStatsMetric;
+
+typedef enum asubExecStatsHistogram {
+   asubExecStatsLatencyHist = 0,       /* end to end latency */
+   asubExecStatsQueueHist,             /* queue wait */
+   asubExecStatsHistogramCount         /* Must be last */
+} asubExecStatsHistogram;
+
+/* Cumulative counters - updated by the record's execute thread only.
+ */
+typedef struct asubExecStatsCounters {
+   epicsUInt64 executions;
+   epicsUInt64 failures;
+   epicsUInt64 timeouts;
+   epicsUInt64 bytesIn;
+   epicsUInt64 bytesOut;
+   epicsUInt64 latencySum;             /* nSec */
+   epicsUInt64 latencyMax;             /* nSec */
+   epicsUInt64 queueSum;               /* nSec */
+   epicsUInt64 sloMinor;               /* latency threshold breaches */
+   epicsUInt64 sloMajor;
+   epicsUInt64 deferred;               /* updated by record processing */
+   epicsUInt64 clamped;                /* output transform counts */
+   epicsUInt64 nans;
+   epicsUInt64 perfExecutions;         /* executions with perf counters */
+   epicsUInt64 perf [asubExecPerfCount];  /* perf counter totals */
+   epicsUInt64 execHits;               /* EXECLINK program cache */
+   epicsUInt64 execColdStarts;
+   epicsUInt64 recycles;               /* persistent workers replaced */
+   epicsUInt64 detached;               /* detached mode children */
+   epicsUInt64 detachedFailures;
+   epicsUInt64 detachedRejected;
+   epicsUInt64 hist [asubExecStatsHistogramCount][asubExecStatsBuckets];
+} asubExecStatsCounters;
+
+typedef struct asubExecStats {
+   ELLNODE node;                       /* must be first */
+   char* recordName;
+   char* exec;                         /* NULL until the asubExec record attaches */
+   IOSCANPVT ioscan;
+
+   asubExecStatsCounters counters;     /* hot path - atomic updates only */
+
+   /* The following are only accessed by the stats thread/readers under lock.
+    */
+   asubExecStatsCounters previous;     /* snapshot as at the previous period */
+   double derived [asubExecStatsMetricCount];
+} asubExecStats;
+
+/* Finds, or creates if needs be, the statistics for the named record.
+ * This is used both by the asubExec record (passing its EXEC) and by the
+ * device support (passing a NULL exec), in any order.
+ */
+asubExecStats* asubExecStatsAttach (const char* recordName, const char* exec);
+
+/* Accumulates a completed execution trace. Lock free.
+ */
+void asubExecStatsUpdate (asubExecStats* stats, const asubExecTrace* trace);
+
+/* Counts a request deferred by the rate limiter. Lock free.
+ */
+void asubExecStatsDefer (asubExecStats* stats);
+
+/* Accumulates output transform (POST_x) counts. Lock free.
+ */
+void asubExecStatsTransform (asubExecStats* stats, const epicsUInt64 clamped,
+                             const epicsUInt64 nans);
+
+/* Accumulates one execution's perf counter values. Lock free.
+ */
+void asubExecStatsPerf (asubExecStats* stats, const uint64_t values[asubExecPerfCount]);
+
+/* Counts an EXECLINK program selection, either a cache hit or a cold start,
+ * i.e. a resolution (and so a new worker, if persistent). Lock free.
+ */
+void asubExecStatsExecCache (asubExecStats* stats, const bool hit);
+
+/* Counts a persistent worker recycled. Lock free.
+ */
+void asubExecStatsRecycle (asubExecStats* stats);
+
+/* Counts a detached child process started, or a request rejected as there
+ * are already DETACHED_MAX outstanding. Lock free.
+ */
+void asubExecStatsDetach (asubExecStats* stats, const bool rejected);
+
+/* Counts a detached child process that failed or timed out. Lock free.
+ */
+void asubExecStatsDetachedFailure (asubExecStats* stats);
+
+/* Counts an execution starting (true) or completing (false) for the IOC wide
+ * concurrency metrics. Lock free.
+ */
+void asubExecStatsActive (const bool start);
+
+/* The IOC wide concurrency metrics, as per the last period.
+ */
+void asubExecStatsConcurrencyValues (double* mean, double* peak);
+
+/* Returns the current value of the given metric.
+ */
+double asubExecStatsValue (asubExecStats* stats, const asubExecStatsMetric metric);
+
+/* Copies up to number histogram buckets into values, returns number copied.
+ */
+int asubExecStatsHistogramValues (asubExecStats* stats, const asubExecStatsHistogram which,
+                                  double* values, const int number);
+
+/* Takes a consistant-enough copy of the cumulative counters. Lock free.
+ */
+void asubExecStatsSnapshot (const asubExecStats* stats, asubExecStatsCounters* counters);
+
+/* Calls func for each statistics item while holding the statistics lock.
+ */
+typedef void (*asubExecStatsIterator) (asubExecStats* stats, void* context);
+void asubExecStatsIterate (asubExecStatsIterator func, void* context);
+
+/* Upper bound of histogram bucket k in seconds, infinite for the last bucket.
+ */
+double asubExecStatsBucketLimit (const int k);
+
+/* Metric name lookup, e.g. "p99" => asubExecStatsP99. Returns -1 if unknown.
+ */
+int asubExecStatsMetricByName (const char* name);
+int asubExecStatsHistogramByName (const char* name);
+const char* asubExecStatsMetricName (const asubExecStatsMetric metric);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_STATS_H */
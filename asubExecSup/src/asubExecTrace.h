@@ -0,0 +1,101 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/asubExecTrace.h $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Per execution trace information, i.e. when each phase of an execution
+ * occured together with byte counts and the outcome. This is collected by
+ * the asubExec module for each execution and made available to the flight
+ * recorder and other diagnostic functions.
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#ifndef ASUB_EXEC_TRACE_H
+#define ASUB_EXEC_TRACE_H 1
+
+#include <time.h>
+#include <epicsTypes.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Execution phases, in the order in which they occur.
+ * Add new values to the end of this list.
+ */
+typedef enum asubExecPhase {
+   asubExecPhaseQueued = 0,            /* record processed, execution requested */
+   asubExecPhaseStart,                 /* execute thread picked up request */
+   asubExecPhaseSpawned,               /* child process created */
+   asubExecPhaseWritten,               /* all inputs written to child */
+   asubExecPhaseRead,                  /* all outputs read from child */
+   asubExecPhaseReaped,                /* child exit status collected */
+   asubExecPhaseCount                  /* Must be last */
+} asubExecPhase;
+
+/* Trace flags
+ */
+#define asubExecTraceFailed        0x0001  /* execution deemed to have failed */
+#define asubExecTraceTimeout       0x0002  /* child process timed out */
+#define asubExecTraceShutdown      0x0004  /* IOC shutdown during execution */
+#define asubExecTraceLatencyMinor  0x0008  /* LATENCY_MINOR threshold exceeded */
+#define asubExecTraceLatencyMajor  0x0010  /* LATENCY_MAJOR threshold exceeded */
+#define asubExecTraceShared        0x0020  /* response shared from another record */
+
+typedef struct asubExecTrace {
+   epicsUInt64 time [asubExecPhaseCount];  /* nSec since 1970, 0 if phase not reached */
+   epicsUInt64 bytesIn;                /* bytes written to the child process */
+   epicsUInt64 bytesOut;               /* bytes read from the child process */
+   epicsInt32 pid;                     /* child process' pid */
+   epicsInt32 exitCode;                /* child process' (pseudo) exit code */
+   epicsUInt32 flags;                  /* asubExecTraceXxxx flags */
+} asubExecTrace;
+
+/* Current time in nSec since 1970.
+ */
+static inline epicsUInt64 asubExecTraceNow (void)
+{
+   struct timespec ts;
+   clock_gettime (CLOCK_REALTIME, &ts);
+   return (epicsUInt64) ts.tv_sec * 1000000000ULL + (epicsUInt64) ts.tv_nsec;
+}
+
+/* Time between two phases in seconds, or -1.0 if either phase not reached.
+ */
+static inline double asubExecTraceInterval (const asubExecTrace* trace,
+                                            const asubExecPhase from,
+                                            const asubExecPhase to)
+{
+   if (trace->time [from] == 0 || trace->time [to] < trace->time [from]) return -1.0;
+   return (double) (trace->time [to] - trace->time [from]) * 1.0e-9;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  /* ASUB_EXEC_TRACE_H */
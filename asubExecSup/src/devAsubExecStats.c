@@ -0,0 +1,291 @@
+/* $File: //ASP/tec/epics/asubExec/trunk/asubExecSup/src/devAsubExecStats.c $
+ * $Revision$
+ * $DateTime$
+ * Last checked in by: $Author$
+ *
+ * Device support for reading asubExec performance statistics into ai, longin
+ * and waveform records.
+ *
+ * Example:
+ *
+ * record (ai, "MIDPT:ASUB:EXEC:P99") {
+ *   field (DTYP, "asubExec Stats")
+ *   field (INP,  "@MIDPT:ASUB:EXEC p99")
+ *   field (SCAN, "I/O Intr")
+ *   field (EGU,  "s")
+ * }
+ *
+ * The INP parameter is the asubExec record name followed by the metric name,
+ * one of: executions, failures, timeouts, rate, p50, p90, p99, mean, max,
+ * queue, queue_p99, bytes_in, bytes_out, slo_minor and slo_major. Waveform records (FTVL DOUBLE)
+ * may read the hist or queue_hist histograms.
+ *
+ * I/O Intr records are processed every asubExecStatsPeriod seconds.
+ *
+ * Source code formatting:  indent -kr -pcs -i3 -cli3 -nut -l96
+ *
+ * Copyright (c) 2026  Australian Synchrotron
+ *
+ * The asubExec module is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by the
+ * Free Software Foundation, either version 3 of the License, or (at your
+ * option) any later version.
+ *
+ * You can also redistribute the asubExec module and/or modify it under the
+ * terms of the Lesser GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version when this library is disributed with and as part of the
+ * EPICS QT Framework (https://github.com/qtepics).
+ *
+ * The asubExec module is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with the asubExec library. If not, see <http://www.gnu.org/licenses/>.
+ *
+ * Contact details:
+ * andrew.starritt@synchrotron.org.au
+ * 800 Blackburn Road, Clayton, Victoria 3168, Australia.
+ */
+
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <aiRecord.h>
+#include <alarm.h>
+#include <cantProceed.h>
+#include <dbAccess.h>
+#include <dbDefs.h>
+#include <dbScan.h>
+#include <devSup.h>
+#include <epicsExport.h>
+#include <errlog.h>
+#include <link.h>
+#include <longinRecord.h>
+#include <menuFtype.h>
+#include <recGbl.h>
+#include <waveformRecord.h>
+
+#include "asubExecStats.h"
+
+typedef struct StatsDpvt {
+   asubExecStats* stats;
+   int metric;                    /* asubExecStatsMetric or -1 */
+   int histogram;                 /* asubExecStatsHistogram or -1 */
+} StatsDpvt;
+
+
+/*------------------------------------------------------------------------------
+ * Parse the INST_IO link and attach to the record's statistics.
+ * Returns NULL on failure.
+ */
+static StatsDpvt* parseLink (dbCommon* prec, struct link* plink, const bool isArray)
+{
+   char recordName [PVNAME_STRINGSZ];
+   char metricName [32];
+
+   if (plink->type != INST_IO) {
+      recGblRecordError (S_dev_badInpType, prec, "devAsubExecStats: INP must be INST_IO");
+      return NULL;
+   }
+
+   const char* parm = plink->value.instio.string;
+   if (sscanf (parm, "%60s %31s", recordName, metricName) != 2) {
+      errlogPrintf ("%s devAsubExecStats: invalid INP '%s', expecting '@record metric'\n",
+                    prec->name, parm);
+      recGblRecordError (S_db_badField, prec, "devAsubExecStats: bad INP");
+      return NULL;
+   }
+
+   StatsDpvt* dpvt = (StatsDpvt*) callocMustSucceed (1, sizeof (StatsDpvt),
+                                                      "devAsubExecStats");
+   dpvt->metric = isArray ? -1 : asubExecStatsMetricByName (metricName);
+   dpvt->histogram = isArray ? asubExecStatsHistogramByName (metricName) : -1;
+
+   if (dpvt->metric < 0 && dpvt->histogram < 0) {
+      errlogPrintf ("%s devAsubExecStats: unknown %s '%s'\n",
+                    prec->name, isArray ? "histogram" : "metric", metricName);
+      recGblRecordError (S_db_badField, prec, "devAsubExecStats: bad INP");
+      free (dpvt);
+      return NULL;
+   }
+
+   dpvt->stats = asubExecStatsAttach (recordName, NULL);
+   return dpvt;
+}
+
+/*------------------------------------------------------------------------------
+ * Common read pre-amble. Returns false if the value is not available.
+ */
+static bool checkStats (dbCommon* prec)
+{
+   StatsDpvt* dpvt = (StatsDpvt*) prec->dpvt;
+   if (!dpvt) return false;
+
+   /* A NULL exec means there is no such asubExec record.
+    */
+   if (!dpvt->stats->exec) {
+      recGblSetSevr (prec, READ_ALARM, INVALID_ALARM);
+      return false;
+   }
+   return true;
+}
+
+/*------------------------------------------------------------------------------
+ */
+static long getIoIntInfo (int cmd, dbCommon* prec, IOSCANPVT* ppvt)
+{
+   StatsDpvt* dpvt = (StatsDpvt*) prec->dpvt;
+   if (!dpvt) return -1;
+   *ppvt = dpvt->stats->ioscan;
+   return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ * ai
+ */
+static long initAi (aiRecord* prec)
+{
+   prec->dpvt = parseLink ((dbCommon*) prec, &prec->inp, false);
+   return prec->dpvt ? 0 : S_dev_NoInit;
+}
+
+static long readAi (aiRecord* prec)
+{
+   if (!checkStats ((dbCommon*) prec)) return 2;
+
+   StatsDpvt* dpvt = (StatsDpvt*) prec->dpvt;
+   prec->val = asubExecStatsValue (dpvt->stats, dpvt->metric);
+   prec->udf = FALSE;
+   return 2;                    /* no conversion */
+}
+
+
+/*------------------------------------------------------------------------------
+ * longin
+ */
+static long initLongin (longinRecord* prec)
+{
+   prec->dpvt = parseLink ((dbCommon*) prec, &prec->inp, false);
+   return prec->dpvt ? 0 : S_dev_NoInit;
+}
+
+static long readLongin (longinRecord* prec)
+{
+   if (!checkStats ((dbCommon*) prec)) return 0;
+
+   StatsDpvt* dpvt = (StatsDpvt*) prec->dpvt;
+   prec->val = (epicsInt32) asubExecStatsValue (dpvt->stats, dpvt->metric);
+   prec->udf = FALSE;
+   return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ * waveform
+ */
+static long initWaveform (waveformRecord* prec)
+{
+   if (prec->ftvl != menuFtypeDOUBLE) {
+      recGblRecordError (S_db_badField, prec, "devAsubExecStats: FTVL must be DOUBLE");
+      return S_db_badField;
+   }
+   prec->dpvt = parseLink ((dbCommon*) prec, &prec->inp, true);
+   return prec->dpvt ? 0 : S_dev_NoInit;
+}
+
+static long readWaveform (waveformRecord* prec)
+{
+   if (!checkStats ((dbCommon*) prec)) return 0;
+
+   StatsDpvt* dpvt = (StatsDpvt*) prec->dpvt;
+   prec->nord = asubExecStatsHistogramValues (dpvt->stats, dpvt->histogram,
+                                              (double*) prec->bptr, prec->nelm);
+   prec->udf = FALSE;
+   return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ * Report (dbior) - per record perf counter means per execution.
+ */
+static void reportRecord (asubExecStats* stats, void* context)
+{
+   const int level = *(const int*) context;
+   asubExecStatsCounters c;
+   int k;
+
+   if (!stats->exec) return;
+
+   asubExecStatsSnapshot (stats, &c);
+   if (c.perfExecutions == 0 && level < 1) return;
+
+   printf ("  %s: %llu executions, %llu with perf counters\n", stats->recordName,
+           (unsigned long long) c.executions, (unsigned long long) c.perfExecutions);
+   if (c.perfExecutions == 0) return;
+
+   for (k = 0; k < asubExecPerfCount; k++) {
+      const double mean = (double) c.perf [k] / (double) c.perfExecutions;
+      if (k == asubExecPerfTaskClock) {
+         printf ("    %-18s %.6f s\n", asubExecPerfName (k), mean * 1.0e-9);
+      } else {
+         printf ("    %-18s %.0f\n", asubExecPerfName (k), mean);
+      }
+   }
+}
+
+static long report (int level)
+{
+   printf ("asubExec perf counters (mean per execution):\n");
+   asubExecStatsIterate (reportRecord, &level);
+   return 0;
+}
+
+
+/*------------------------------------------------------------------------------
+ * Device support entry tables
+ */
+struct {
+   long number;
+   DEVSUPFUN report;
+   DEVSUPFUN init;
+   DEVSUPFUN init_record;
+   DEVSUPFUN get_ioint_info;
+   DEVSUPFUN read;
+   DEVSUPFUN special_linconv;
+} devAiAsubExecStats = {
+   6, (DEVSUPFUN) report, NULL, (DEVSUPFUN) initAi, (DEVSUPFUN) getIoIntInfo, (DEVSUPFUN) readAi, NULL
+};
+
+struct {
+   long number;
+   DEVSUPFUN report;
+   DEVSUPFUN init;
+   DEVSUPFUN init_record;
+   DEVSUPFUN get_ioint_info;
+   DEVSUPFUN read;
+} devLiAsubExecStats = {
+   5, NULL, NULL, (DEVSUPFUN) initLongin, (DEVSUPFUN) getIoIntInfo, (DEVSUPFUN) readLongin
+};
+
+struct {
+   long number;
+   DEVSUPFUN report;
+   DEVSUPFUN init;
+   DEVSUPFUN init_record;
+   DEVSUPFUN get_ioint_info;
+   DEVSUPFUN read;
+} devWfAsubExecStats = {
+   5, NULL, NULL, (DEVSUPFUN) initWaveform, (DEVSUPFUN) getIoIntInfo, (DEVSUPFUN) readWaveform
+};
+
+epicsExportAddress (dset, devAiAsubExecStats);
+epicsExportAddress (dset, devLiAsubExecStats);
+epicsExportAddress (dset, devWfAsubExecStats);
+
+/* end */
@@ -0,0 +1,89 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecTestApp/Db/maxrate_test.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Description
+# Tests MAXRATE deferral (see maxrate_test.db): writes a rapid series of values
+# to MAXRATE:SRC and checks that, once the deferred execution has completed,
+# MAXRATE:RESULT holds the last value written, that the updates were coalesced
+# into few executions, and that the record was not left in a SCAN alarm.
+#
+# Uses the EPICS caput and caget command line tools.
+#
+# usage: maxrate_test.py [options]
+#
+
+import argparse
+import subprocess
+import sys
+import time
+
+
+# ------------------------------------------------------------------------------
+#
+def caput(pv, value):
+    subprocess.run(["caput", "-t", pv, str(value)], check=True,
+                   stdout=subprocess.DEVNULL)
+
+
+# ------------------------------------------------------------------------------
+#
+def caget(pv, *options):
+    result = subprocess.run(["caget", "-t"] + list(options) + [pv], check=True,
+                            stdout=subprocess.PIPE, universal_newlines=True)
+    return result.stdout.strip()
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    parser = argparse.ArgumentParser(description="Tests asubExec MAXRATE deferral")
+    parser.add_argument("-n", "--number", type=int, default=20,
+                        help="number of rapid updates (default 20)")
+    parser.add_argument("--settle", type=float, default=3.0,
+                        help="time allowed for the deferred execution, seconds (default 3)")
+    args = parser.parse_args()
+
+    # Use up the token, then let the bucket refill, so the first update executes.
+    #
+    caput("MAXRATE:SRC", 0)
+    time.sleep(args.settle)
+
+    executions = float(caget("MAXRATE:EXEC:EXECUTIONS"))
+
+    for value in range(1, args.number + 1):
+        caput("MAXRATE:SRC", value)
+
+    time.sleep(args.settle)
+
+    result = float(caget("MAXRATE:RESULT"))
+    executed = float(caget("MAXRATE:EXEC:EXECUTIONS")) - executions
+    status = caget("MAXRATE:EXEC.STAT")
+
+    print("result %g, expected %d" % (result, args.number))
+    print("%d executions for %d updates" % (executed, args.number))
+    print("status %s" % status)
+
+    failed = False
+    if result != args.number:
+        print("FAIL: last update not executed")
+        failed = True
+    if executed > 3:
+        print("FAIL: updates not coalesced")
+        failed = True
+    if status == "SCAN":
+        print("FAIL: updates dropped while active")
+        failed = True
+
+    if not failed:
+        print("PASS")
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# end
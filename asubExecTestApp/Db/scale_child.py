@@ -0,0 +1,48 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecTestApp/Db/scale_child.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Scale test child process - see scale_test.template
+# Echos input A to output VALA after simulating ARG2 mSec of work.
+# Deliberately quiet: nothing is written to stderr unless there is an error.
+#
+
+import sys
+import time
+
+from asubExec import asubExecIO
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    try:
+        work = float(sys.argv[2]) if len(sys.argv) > 2 else 0.0
+    except ValueError:
+        work = 0.0
+
+    io = asubExecIO()
+
+    if not io.unpack(sys.stdin.buffer):
+        return 4
+
+    if work > 0.0:
+        time.sleep(work / 1000.0)
+
+    output = {'outa': io.input_data['inpa']}
+
+    if not io.pack(output, sys.stdout.buffer):
+        return 4
+
+    return 0
+
+
+if __name__ == "__main__":
+    n = main()
+    sys.exit(n)
+    # do not use os._exit here
+
+# end
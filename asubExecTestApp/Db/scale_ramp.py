@@ -0,0 +1,205 @@
+#!/bin/env python
+#
+# $File: //ASP/tec/epics/asubExec/trunk/asubExecTestApp/Db/scale_ramp.py $
+# $Revision$
+# $DateTime$
+# Last checked in by: $Author$
+#
+# Description
+# Ramps the scale test load (see scale_driver.template) in steps, and at each
+# step collects the asubExec metrics written by the IOC (asubExecMetricsFile),
+# reporting the offered and achieved execution rates, failures, timeouts and
+# latency percentiles. The saturation point is the first step at which the
+# achieved rate falls short of the offered rate, or the p99 latency exceeds
+# the given limit.
+#
+# The load rate is set using the EPICS caput command line tool.
+#
+# usage: scale_ramp.py [options] metrics_file
+#
+
+import argparse
+import os
+import re
+import subprocess
+import sys
+import time
+
+SampleRegex = re.compile(r'^(\w+)\{record="([^"]*)",exec="[^"]*"(?:,le="([^"]*)")?\} (\S+)$')
+
+
+# ------------------------------------------------------------------------------
+#
+def read_metrics(filename, record_regex):
+    """ Returns { 'executions': n, 'failures': n, 'timeouts': n,
+                  'buckets': [(le, count), ...] } summed over matching records.
+    """
+    totals = {'executions': 0.0, 'failures': 0.0, 'timeouts': 0.0}
+    buckets = {}
+
+    with open(filename, "r") as f:
+        for line in f:
+            match = SampleRegex.match(line.strip())
+            if match is None:
+                continue
+
+            name, record, le, value = match.groups()
+            if not record_regex.search(record):
+                continue
+
+            value = float(value)
+            if name == "asubexec_executions_total":
+                totals['executions'] += value
+            elif name == "asubexec_failures_total":
+                totals['failures'] += value
+            elif name == "asubexec_timeouts_total":
+                totals['timeouts'] += value
+            elif name == "asubexec_latency_seconds_bucket":
+                limit = float("inf") if le == "+Inf" else float(le)
+                buckets[limit] = buckets.get(limit, 0.0) + value
+
+    totals['buckets'] = sorted(buckets.items())
+    return totals
+
+
+# ------------------------------------------------------------------------------
+#
+def records(filename, record_regex):
+    """ Number of matching records in the metrics file """
+    names = set()
+    with open(filename, "r") as f:
+        for line in f:
+            match = SampleRegex.match(line.strip())
+            if match is not None and record_regex.search(match.group(2)):
+                names.add(match.group(2))
+    return len(names)
+
+
+# ------------------------------------------------------------------------------
+#
+def percentile(before, after, q):
+    """ Upper bound of the bucket holding the q'th quantile of the executions
+        between the before and after cumulative histograms.
+    """
+    prior = dict(before)
+    delta = [(le, count - prior.get(le, 0.0)) for le, count in after]
+    if not delta or delta[-1][1] <= 0.0:
+        return float("nan")
+
+    target = q * delta[-1][1]
+    for le, count in delta:
+        if count >= target:
+            return le
+    return float("inf")
+
+
+# ------------------------------------------------------------------------------
+#
+def set_rate(pv, rate):
+    subprocess.run(["caput", "-t", pv, "%g" % rate], check=True,
+                   stdout=subprocess.DEVNULL)
+
+
+# ------------------------------------------------------------------------------
+#
+def wait_update(filename, period):
+    """ Waits for the metrics file to be re-written, at most two periods """
+    try:
+        mtime = os.stat(filename).st_mtime
+    except OSError:
+        mtime = 0
+    end = time.time() + 2.0 * period
+    while time.time() < end:
+        time.sleep(0.1)
+        try:
+            if os.stat(filename).st_mtime != mtime:
+                return
+        except OSError:
+            pass
+
+
+# ------------------------------------------------------------------------------
+#
+def main():
+    parser = argparse.ArgumentParser(description="Ramps the asubExec scale test load")
+    parser.add_argument("-p", "--prefix", default="SCALE",
+                        help="scale test PV prefix (default SCALE)")
+    parser.add_argument("--start", type=float, default=1.0,
+                        help="initial rate per instance, Hz (default 1)")
+    parser.add_argument("--stop", type=float, default=100.0,
+                        help="final rate per instance, Hz (default 100)")
+    parser.add_argument("--factor", type=float, default=1.5,
+                        help="rate multiplier between steps (default 1.5)")
+    parser.add_argument("--dwell", type=float, default=10.0,
+                        help="time at each step, seconds (default 10)")
+    parser.add_argument("--period", type=float, default=1.0,
+                        help="asubExecMetricsFile period, seconds (default 1)")
+    parser.add_argument("--p99-limit", type=float, default=1.0,
+                        help="p99 latency deemed saturated, seconds (default 1)")
+    parser.add_argument("--shortfall", type=float, default=0.05,
+                        help="fractional rate shortfall deemed saturated (default 0.05)")
+    parser.add_argument("--continue", dest="keep_going", action="store_true",
+                        help="continue ramping beyond the saturation point")
+    parser.add_argument("metrics_file")
+    args = parser.parse_args()
+
+    record_regex = re.compile("^" + re.escape(args.prefix) + ":EXEC:")
+    rate_pv = args.prefix + ":LOAD:RATE"
+
+    instances = records(args.metrics_file, record_regex)
+    if instances == 0:
+        print("no %s:EXEC:* records found in %s" % (args.prefix, args.metrics_file))
+        return 1
+
+    print("%d instances" % instances)
+    print("%10s %10s %10s %8s %8s %10s %10s" %
+          ("rate/inst", "offered", "achieved", "failed", "timeout", "p50 (s)", "p99 (s)"))
+
+    saturation = None
+    rate = args.start
+    try:
+        while rate <= args.stop * 1.0001:
+            set_rate(rate_pv, rate)
+            time.sleep(args.period)      # settle
+            wait_update(args.metrics_file, args.period)
+            before = read_metrics(args.metrics_file, record_regex)
+            t0 = time.time()
+
+            time.sleep(args.dwell)
+            wait_update(args.metrics_file, args.period)
+            after = read_metrics(args.metrics_file, record_regex)
+            elapsed = time.time() - t0
+
+            offered = rate * instances
+            achieved = (after['executions'] - before['executions']) / elapsed
+            failed = after['failures'] - before['failures']
+            timeouts = after['timeouts'] - before['timeouts']
+            p50 = percentile(before['buckets'], after['buckets'], 0.50)
+            p99 = percentile(before['buckets'], after['buckets'], 0.99)
+
+            print("%10.2f %10.2f %10.2f %8d %8d %10.4g %10.4g" %
+                  (rate, offered, achieved, failed, timeouts, p50, p99))
+            sys.stdout.flush()
+
+            if saturation is None and (achieved < (1.0 - args.shortfall) * offered or
+                                       p99 > args.p99_limit):
+                saturation = (rate, offered, achieved, p99)
+                if not args.keep_going:
+                    break
+
+            rate *= args.factor
+    finally:
+        set_rate(rate_pv, 0.0)
+
+    if saturation is None:
+        print("not saturated at %.2f Hz per instance" % args.stop)
+    else:
+        print("saturated at %.2f Hz per instance: offered %.2f/s, achieved %.2f/s, p99 %.4gs" %
+              saturation)
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
+
+# end
@@ -23,11 +23,25 @@ asubExecTest_registerRecordDeviceDriver pdbbase
 #
 var asubExecDebug 2
  
+# Record recent executions for post-mortem analysis.
+#
+asubExecFlightRecorder ("/tmp/asubExecTest.flight", 1024)
+ 
 ## Load record instances
 #
 ## dbLoadRecords("db/example.db", "")
 dbLoadRecords("db/mid_points.db", "")
  
+## Scale test - load instead of the above, and run scale_ramp.py against
+## the metrics file, e.g. scale_ramp.py /tmp/asubExecTest.prom
+#
+## asubExecMetricsFile ("/tmp/asubExecTest.prom", 1.0)
+## dbLoadRecords("db/scale_test.db", "")
+ 
+## MAXRATE test - run maxrate_test.py against this database
+#
+## dbLoadRecords("db/maxrate_test.db", "")
+ 
 cd "${TOP}/iocBoot/${IOC}"
 iocInit
  